@@ -0,0 +1,39 @@
+// example/example_coroutine.cpp
+#include "zuno/RestClient.hpp"
+#include <iostream>
+#include <string>
+
+zuno::Task<> run(zuno::RestClient &client) {
+  // The coroutine suspends while the request runs on the client's transfer
+  // loop; no thread is blocked waiting for it.
+  zuno::HttpResponse getResp =
+      co_await client.co_get("https://jsonplaceholder.typicode.com/posts/1");
+  std::cout << "[GET Body]\n" << getResp.body << "\n\n";
+
+  nlohmann::json postData = {{"title", "foo"}, {"body", "bar"}, {"userId", 1}};
+  zuno::HttpResponse postResp = co_await client.co_post(
+      "https://jsonplaceholder.typicode.com/posts", postData);
+  std::cout << "[POST Status] " << postResp.statusCode << "\n\n";
+
+  // Streaming response consumed chunk by chunk
+  auto stream = client.co_getStream("https://jsonplaceholder.typicode.com/posts");
+  while (auto chunk = co_await stream.next()) {
+    if (!chunk->isLast) {
+      std::cout << "Received chunk: " << chunk->data.size() << " bytes"
+                << std::endl;
+    } else {
+      std::cout << "Stream completed." << std::endl;
+    }
+  }
+  std::cout << "Stream status code: " << stream.response().statusCode
+            << std::endl;
+}
+
+int main() {
+  zuno::RestClient client;
+
+  // Block main() until the coroutine finishes
+  zuno::syncWait(run(client));
+
+  return 0;
+}
@@ -0,0 +1,174 @@
+// example/example_transport.cpp
+//
+// Drives the client through FakeTransport and RecordReplayTransport without
+// touching the network. Doubles as the offline test: exits non-zero if any
+// check fails.
+#include "zuno/FakeTransport.hpp"
+#include "zuno/RecordReplayTransport.hpp"
+#include "zuno/RestClient.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what) {
+  std::cout << (condition ? "[ok]   " : "[FAIL] ") << what << std::endl;
+  if (!condition) {
+    ++failures;
+  }
+}
+
+// Echoes the request back so every check can see what the server received.
+zuno::HttpResponse echo(const zuno::TransportRequest &request) {
+  zuno::HttpResponse response{};
+  response.statusCode = request.url.find("/missing") != std::string::npos
+                            ? 404
+                            : 200;
+  response.headers["content-type"] = "application/json";
+  response.body = nlohmann::json{{"method", request.method},
+                                 {"url", request.url},
+                                 {"body", request.body}}
+                      .dump();
+  return response;
+}
+
+zuno::Task<std::string> readStream(zuno::ChunkStream stream, int &chunks) {
+  std::string body;
+  while (auto chunk = co_await stream.next()) {
+    if (chunk->isLast) {
+      break;
+    }
+    body += chunk->data;
+    ++chunks;
+  }
+  co_return body;
+}
+
+zuno::Task<zuno::HttpResponse> coGet(zuno::RestClient &client,
+                                     const std::string &url) {
+  co_return co_await client.co_get(url);
+}
+
+void runFake() {
+  zuno::FakeTransport::Profile profile;
+  profile.latency =
+      zuno::FakeTransport::fixedLatency(std::chrono::milliseconds(2));
+  // Small chunks, so streams arrive in several pieces
+  profile.chunkSize = 16;
+  auto fake = std::make_shared<zuno::FakeTransport>(echo, profile);
+
+  zuno::RestClient client;
+  client.setTransport(fake);
+
+  zuno::HttpResponse get = client.get("http://api.test/items/1");
+  check(get.success && get.statusCode == 200, "sync GET succeeds");
+  check(get.json()["url"] == "http://api.test/items/1",
+        "sync GET reaches the responder");
+  check(get.headers["content-type"] == "application/json",
+        "sync GET returns headers");
+
+  zuno::HttpResponse post =
+      client.post("http://api.test/items", {{"name", "widget"}});
+  check(post.json()["method"] == "POST" &&
+            nlohmann::json::parse(post.json()["body"].get<std::string>()) ==
+                nlohmann::json{{"name", "widget"}},
+        "sync POST sends its body");
+
+  zuno::HttpResponse missing = client.get("http://api.test/missing");
+  check(!missing.success && missing.statusCode == 404,
+        "HTTP errors are reported");
+
+  zuno::HttpResponse coResponse =
+      zuno::syncWait(coGet(client, "http://api.test/items/2"));
+  check(coResponse.success &&
+            coResponse.json()["url"] == "http://api.test/items/2",
+        "co_get succeeds");
+
+  int chunks = 0;
+  std::string streamed = zuno::syncWait(
+      readStream(client.co_getStream("http://api.test/s"), chunks));
+  check(nlohmann::json::parse(streamed)["url"] == "http://api.test/s" &&
+            chunks > 1,
+        "co_getStream delivers the body in chunks");
+
+  std::string callbackBody;
+  zuno::BaseResponse streamResponse = client.getStream(
+      "http://api.test/s", [&callbackBody](const zuno::StreamChunk &chunk) {
+        callbackBody += chunk.data;
+      });
+  check(streamResponse.success && callbackBody == streamed,
+        "getStream delivers the same body");
+
+  check(fake->requestCount() == 6, "every request reached the fake");
+
+  zuno::FakeTransport::Profile failing;
+  failing.errorRate = 1.0;
+  client.setTransport(std::make_shared<zuno::FakeTransport>(echo, failing));
+  zuno::HttpResponse failed = client.get("http://api.test/items/1");
+  check(!failed.success && failed.statusCode == 0,
+        "connection failures report status 0");
+}
+
+void runRecordReplay() {
+  std::string path =
+      (std::filesystem::temp_directory_path() / "zuno-example-transport.zrr")
+          .string();
+
+  auto fake = std::make_shared<zuno::FakeTransport>(echo);
+  auto recorder = std::make_shared<zuno::RecordReplayTransport>(fake);
+
+  zuno::RestClient client;
+  client.setTransport(recorder);
+  zuno::HttpResponse first = client.get("http://api.test/items/1");
+  zuno::HttpResponse posted =
+      client.post("http://api.test/items", {{"name", "widget"}});
+  zuno::HttpResponse missing = client.get("http://api.test/missing");
+  check(recorder->save(path), "recording is saved");
+
+  auto replay = std::make_shared<zuno::RecordReplayTransport>(path);
+  client.setTransport(replay);
+  std::uint64_t served = fake->requestCount();
+
+  zuno::HttpResponse replayedFirst = client.get("http://api.test/items/1");
+  check(replayedFirst.statusCode == first.statusCode &&
+            replayedFirst.body == first.body &&
+            replayedFirst.headers == first.headers,
+        "replayed GET matches the recording");
+
+  zuno::HttpResponse replayedMissing =
+      zuno::syncWait(coGet(client, "http://api.test/missing"));
+  check(replayedMissing.statusCode == 404 &&
+            replayedMissing.body == missing.body,
+        "replayed co_get matches the recording");
+
+  zuno::HttpResponse replayedPosted =
+      client.post("http://api.test/items", {{"name", "widget"}});
+  check(replayedPosted.body == posted.body,
+        "replay matches on method, URL and body");
+
+  zuno::HttpResponse unknown = client.get("http://api.test/never");
+  check(!unknown.success && unknown.statusCode == 0,
+        "unrecorded requests fail");
+
+  check(fake->requestCount() == served, "replay does no I/O");
+
+  std::remove(path.c_str());
+}
+
+} // namespace
+
+int main() {
+  runFake();
+  runRecordReplay();
+
+  if (failures > 0) {
+    std::cout << failures << " check(s) failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return 0;
+}
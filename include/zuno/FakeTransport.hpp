@@ -0,0 +1,89 @@
+// include/zuno/FakeTransport.hpp
+
+#ifndef ZUNO_FAKE_TRANSPORT_HPP
+#define ZUNO_FAKE_TRANSPORT_HPP
+
+#include "Transport.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+
+namespace zuno {
+
+// In-process server for load and latency testing. Responses come from a
+// responder function; latency, bandwidth and failures are simulated by
+// sleeping on the calling thread, or with timers on the client's loop for the
+// coroutine methods. With the default profile nothing waits, so throughput is
+// bound only by the responder.
+class FakeTransport : public Transport {
+public:
+  using Responder = std::function<HttpResponse(const TransportRequest &)>;
+  using LatencyDistribution =
+      std::function<std::chrono::microseconds(std::mt19937_64 &)>;
+
+  struct Profile {
+    // Time to first byte; none when empty
+    LatencyDistribution latency;
+    // Body delivery rate in bytes per second; 0 for unlimited
+    double bandwidth = 0;
+    // Bytes per delivered chunk
+    size_t chunkSize = 16 * 1024;
+    // Probability of a connection-level failure (success = false, status 0)
+    double errorRate = 0;
+    // Probability of answering errorStatus instead of calling the responder
+    double httpErrorRate = 0;
+    int errorStatus = 503;
+    // Seeds the random choices. Each request's are derived from the seed and
+    // the request's number on this transport, so a run that sends requests
+    // in the same order reproduces them from any thread.
+    std::uint64_t seed = 0;
+  };
+
+  FakeTransport();
+  explicit FakeTransport(Responder responder);
+  FakeTransport(Responder responder, Profile profile);
+
+  BaseResponse perform(const TransportRequest &request,
+                       const ChunkSink &onChunk) override;
+  void performAsync(TransportRequest request, ChunkSink onChunk,
+                    CompletionHandler onDone,
+                    TransportScheduler &scheduler) override;
+
+  // Number of requests served, failures included.
+  std::uint64_t requestCount() const { return requests.load(); }
+
+  static LatencyDistribution fixedLatency(std::chrono::microseconds value);
+  static LatencyDistribution uniformLatency(std::chrono::microseconds min,
+                                            std::chrono::microseconds max);
+  static LatencyDistribution normalLatency(std::chrono::microseconds mean,
+                                           std::chrono::microseconds stddev);
+  // Long-tailed; sigma around 0.5-1.0 gives realistic p99/p50 ratios.
+  static LatencyDistribution logNormalLatency(std::chrono::microseconds median,
+                                              double sigma);
+
+private:
+  // Random choices for one request, drawn up front.
+  struct Draw {
+    std::chrono::microseconds latency{0};
+    bool connectionError = false;
+    bool httpError = false;
+  };
+
+  // Counts the request and draws its random choices.
+  Draw draw();
+  // Fills in result unless the request drew a connection error.
+  bool respond(const TransportRequest &request, const Draw &random,
+               HttpResponse &result);
+
+  Responder responder;
+  Profile profile;
+  // Whether the profile needs random choices at all
+  bool randomized;
+  std::atomic<std::uint64_t> requests{0};
+};
+
+} // namespace zuno
+
+#endif // ZUNO_FAKE_TRANSPORT_HPP
@@ -0,0 +1,87 @@
+// include/zuno/RecordReplayTransport.hpp
+
+#ifndef ZUNO_RECORD_REPLAY_TRANSPORT_HPP
+#define ZUNO_RECORD_REPLAY_TRANSPORT_HPP
+
+#include "Transport.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace zuno {
+
+// Records request/response pairs, chunk timing included, while forwarding
+// to another transport, and replays them from memory without any I/O.
+// Requests are matched on method, URL and body; repeated requests replay
+// their recordings in order and wrap around.
+class RecordReplayTransport : public Transport {
+public:
+  // Recording mode: forwards every request to inner.
+  explicit RecordReplayTransport(std::shared_ptr<Transport> inner);
+  // Replay mode: serves responses loaded from a file written by save(). The
+  // recordings never change afterwards, so replay needs no locking; use a
+  // new instance to replay another file.
+  explicit RecordReplayTransport(const std::string &path);
+
+  BaseResponse perform(const TransportRequest &request,
+                       const ChunkSink &onChunk) override;
+  void performAsync(TransportRequest request, ChunkSink onChunk,
+                    CompletionHandler onDone,
+                    TransportScheduler &scheduler) override;
+
+  // Writes everything recorded so far. Returns false on I/O errors.
+  bool save(const std::string &path) const;
+
+  // Reproduce the recorded gaps between chunks instead of replaying as fast
+  // as possible.
+  void setReplayTiming(bool enabled) { replayTiming = enabled; }
+
+  bool isRecording() const { return inner != nullptr; }
+
+private:
+  struct Chunk {
+    std::chrono::microseconds offset;
+    std::string data;
+  };
+
+  struct Exchange {
+    std::string method;
+    std::string url;
+    std::string body;
+    int statusCode = 0;
+    bool success = false;
+    std::unordered_map<std::string, std::string> headers;
+    std::vector<Chunk> chunks;
+  };
+
+  struct Recordings {
+    std::vector<Exchange> exchanges;
+    std::atomic<size_t> next{0};
+  };
+
+  static std::string keyOf(const std::string &method, const std::string &url,
+                           const std::string &body);
+
+  bool load(const std::string &path);
+  void record(Exchange exchange);
+  // The next recording for a request, or nullptr if there is none.
+  const Exchange *find(const TransportRequest &request);
+  static BaseResponse replayedResponse(const Exchange *exchange);
+
+  std::shared_ptr<Transport> inner;
+  std::atomic<bool> replayTiming{false};
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, std::unique_ptr<Recordings>> recordings;
+  // Recording order, so save() writes a stable file
+  std::vector<std::string> keyOrder;
+};
+
+} // namespace zuno
+
+#endif // ZUNO_RECORD_REPLAY_TRANSPORT_HPP
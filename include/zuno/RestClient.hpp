@@ -5,11 +5,17 @@
 
 #include "RequestInterceptor.hpp"
 #include "ResponseInterceptor.hpp"
+#include "Task.hpp"
+#include <coroutine>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <memory>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace zuno {
 
@@ -42,11 +48,80 @@ struct StreamCallbackData {
   bool isFirstChunk;
 };
 
+// Options for downloads written straight to a file
+struct DownloadOptions {
+  // Parallel connections used when the server accepts byte ranges
+  unsigned connections = 4;
+  // Objects are not split into ranges smaller than this
+  size_t minRangeSize = 8 << 20;
+  // Continue from the "<path>.zpart" progress file left by an interrupted
+  // download instead of starting over. Needs an ETag or Last-Modified from
+  // the server to tell that the object has not changed.
+  bool resume = true;
+  // Write through a memory map of the pre-sized file (ignored on Windows)
+  bool useMmap = false;
+};
+
+// Unix domain socket requests are sent over instead of TCP. The URL still
+// supplies the Host header and path.
+struct UnixSocket {
+  std::string path;
+  // Linux abstract namespace socket; path is given without the leading NUL
+  bool abstractNamespace = false;
+};
+
+class EventLoop;
+class HandlePool;
+class SharedCache;
+class Transport;
+
+// Asynchronous sequence of chunks returned by the co_*Stream methods. The
+// transfer starts immediately; chunks are buffered until read and the
+// transfer is paused while the consumer falls behind. Consume with
+//   while (auto chunk = co_await stream.next()) { ... }
+// The last chunk has isLast set, after which next() yields std::nullopt.
+// Destroying the stream early aborts the transfer.
+class ChunkStream {
+public:
+  struct State;
+
+  class NextAwaiter {
+  public:
+    explicit NextAwaiter(State *state) : state(state) {}
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> handle);
+    std::optional<StreamChunk> await_resume();
+
+  private:
+    State *state;
+  };
+
+  explicit ChunkStream(std::shared_ptr<State> state);
+  ChunkStream(ChunkStream &&) noexcept = default;
+  ChunkStream &operator=(ChunkStream &&) noexcept = default;
+  ~ChunkStream();
+
+  NextAwaiter next();
+
+  // Status and headers of the finished transfer; valid once next() has
+  // returned the last chunk.
+  const BaseResponse &response() const;
+
+private:
+  std::shared_ptr<State> state;
+};
+
 class RestClient {
 public:
   RestClient();
   ~RestClient();
 
+  // Copies share the transfer loop with its connection pool, the handle pool
+  // of the blocking methods and the DNS and TLS session cache. Interceptors,
+  // transport and socket routes are copied and can be changed independently.
+  RestClient(const RestClient &) = default;
+  RestClient &operator=(const RestClient &) = default;
+
   // Métodos síncronos - Standard responses
   HttpResponse
   get(const std::string &url,
@@ -121,6 +196,94 @@ public:
   delStreamAsync(const std::string &url, StreamCallback callback,
                  const std::unordered_map<std::string, std::string> &headers = {});
 
+  // Coroutine methods - Standard responses. The request runs on the client's
+  // transfer loop and the awaiting coroutine is resumed on that thread.
+  Task<HttpResponse>
+  co_get(const std::string &url,
+         const std::unordered_map<std::string, std::string> &headers = {});
+  Task<HttpResponse>
+  co_post(const std::string &url, const nlohmann::json &data,
+          const std::unordered_map<std::string, std::string> &headers = {});
+  Task<HttpResponse>
+  co_put(const std::string &url, const nlohmann::json &data,
+         const std::unordered_map<std::string, std::string> &headers = {});
+  Task<HttpResponse>
+  co_patch(const std::string &url, const nlohmann::json &data,
+           const std::unordered_map<std::string, std::string> &headers = {});
+  Task<HttpResponse>
+  co_del(const std::string &url,
+         const std::unordered_map<std::string, std::string> &headers = {});
+  Task<HttpResponse>
+  co_head(const std::string &url,
+          const std::unordered_map<std::string, std::string> &headers = {});
+
+  // Coroutine methods - Streaming responses
+  ChunkStream
+  co_getStream(const std::string &url,
+               const std::unordered_map<std::string, std::string> &headers = {});
+  ChunkStream
+  co_postStream(const std::string &url, const nlohmann::json &data,
+                const std::unordered_map<std::string, std::string> &headers = {});
+  ChunkStream
+  co_putStream(const std::string &url, const nlohmann::json &data,
+               const std::unordered_map<std::string, std::string> &headers = {});
+  ChunkStream
+  co_patchStream(const std::string &url, const nlohmann::json &data,
+                 const std::unordered_map<std::string, std::string> &headers = {});
+  ChunkStream
+  co_delStream(const std::string &url,
+               const std::unordered_map<std::string, std::string> &headers = {});
+
+  // Downloads - The body is written straight to a file or descriptor and
+  // never held in memory. Files are fetched as concurrent byte ranges when
+  // the server answers a one-byte range probe with 206, and as a single
+  // stream otherwise. A single stream goes to "<path>.zdownload" and replaces
+  // path only on a 2xx answer. The synchronous versions wait on the transfer
+  // loop, so call them from ordinary threads only, never from inside a
+  // coroutine resumed by it.
+  BaseResponse
+  download(const std::string &url, const std::string &path,
+           const DownloadOptions &options = {},
+           const std::unordered_map<std::string, std::string> &headers = {});
+  BaseResponse
+  download(const std::string &url, int fd,
+           const std::unordered_map<std::string, std::string> &headers = {});
+  std::future<BaseResponse>
+  downloadAsync(const std::string &url, const std::string &path,
+                const DownloadOptions &options = {},
+                const std::unordered_map<std::string, std::string> &headers = {});
+  std::future<BaseResponse>
+  downloadAsync(const std::string &url, int fd,
+                const std::unordered_map<std::string, std::string> &headers = {});
+  Task<BaseResponse>
+  co_download(const std::string &url, const std::string &path,
+              const DownloadOptions &options = {},
+              const std::unordered_map<std::string, std::string> &headers = {});
+  Task<BaseResponse>
+  co_download(const std::string &url, int fd,
+              const std::unordered_map<std::string, std::string> &headers = {});
+
+  // Connection prewarming - Resolves DNS, connects and completes the TLS
+  // handshake with each origin ("https://api.example.com") in parallel. The
+  // connections stay open on the transfer loop for the coroutine and
+  // download methods, and in the pool of handles the synchronous, async and
+  // stream methods borrow from. Returns the number of origins reached.
+  size_t prewarm(const std::vector<std::string> &origins);
+  Task<size_t> co_prewarm(const std::vector<std::string> &origins);
+
+  // Routing over Unix domain sockets. Configure before issuing requests.
+  // An origin mapping ("http://localhost:15000") takes precedence over the
+  // client-wide socket; an empty path removes the route.
+  void setUnixSocket(const std::string &path, bool abstractNamespace = false);
+  void setOriginUnixSocket(const std::string &origin, const std::string &path,
+                           bool abstractNamespace = false);
+
+  // Replaces curl for the synchronous, asynchronous, streaming and coroutine
+  // request methods; nullptr restores it. Coroutine methods go through
+  // Transport::performAsync and still suspend. Downloads and prewarm always
+  // use curl. Configure before issuing requests.
+  void setTransport(std::shared_ptr<Transport> transport);
+
   void
   setRequestInterceptor(std::shared_ptr<RequestInterceptor> requestInterceptor);
   void setResponseInterceptor(
@@ -138,6 +301,29 @@ private:
                        const std::unordered_map<std::string, std::string> &headers,
                        StreamCallback callback);
 
+  Task<HttpResponse>
+  coPerformRequest(std::string url, std::string method, nlohmann::json data,
+                   std::unordered_map<std::string, std::string> headers);
+
+  ChunkStream
+  coPerformStreamRequest(std::string url, std::string method,
+                         nlohmann::json data,
+                         std::unordered_map<std::string, std::string> headers);
+
+  Task<BaseResponse>
+  coPerformDownload(std::string url, std::string path, DownloadOptions options,
+                    std::unordered_map<std::string, std::string> headers);
+
+  Task<BaseResponse>
+  coPerformFdDownload(std::string url, int fd,
+                      std::unordered_map<std::string, std::string> headers);
+
+  Task<size_t> coPerformPrewarm(std::vector<std::string> origins);
+
+  EventLoop &eventLoop();
+
+  UnixSocket unixSocketFor(const std::string &url) const;
+
   static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
                               void *userp);
                               
@@ -146,6 +332,21 @@ private:
 
   std::shared_ptr<RequestInterceptor> requestInterceptor;
   std::shared_ptr<ResponseInterceptor> responseInterceptor;
+
+  std::shared_ptr<Transport> transport;
+
+  UnixSocket unixSocket;
+  // Keyed by normalized origin, see originOf()
+  std::unordered_map<std::string, UnixSocket> originUnixSockets;
+
+  // Shared by copies of the client, as is the transfer loop.
+  std::shared_ptr<SharedCache> sharedCache;
+  // Easy handles, and their open connections, for the blocking methods
+  std::shared_ptr<HandlePool> handlePool;
+
+  // Owns the transfer loop, started on first use by the coroutine methods.
+  struct LoopHolder;
+  std::shared_ptr<LoopHolder> loopHolder;
 };
 
 } // namespace zuno
@@ -0,0 +1,163 @@
+// include/zuno/Task.hpp
+
+#ifndef ZUNO_TASK_HPP
+#define ZUNO_TASK_HPP
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace zuno {
+
+template <typename T> class Task;
+
+namespace detail {
+
+// Shared promise logic: lazy start and symmetric transfer back to the
+// awaiting coroutine once the task finishes.
+struct TaskPromiseBase {
+  std::coroutine_handle<> continuation = std::noop_coroutine();
+  std::exception_ptr exception;
+
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) const noexcept {
+      return handle.promise().continuation;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object();
+  template <typename U> void return_value(U &&result) {
+    value.emplace(std::forward<U>(result));
+  }
+  T result() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    return std::move(*value);
+  }
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+  void return_void() const noexcept {}
+  void result() {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+};
+
+} // namespace detail
+
+// Lazily started coroutine producing a T. The body runs when the task is
+// first awaited and resumes the awaiting coroutine on whichever thread
+// completes it (for RestClient requests, the client's transfer loop).
+template <typename T = void> class Task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+
+  Task() = default;
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+  Task(Task &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (handle) {
+        handle.destroy();
+      }
+      handle = std::exchange(other.handle, {});
+    }
+    return *this;
+  }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+
+  auto operator co_await() noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      bool await_ready() const noexcept { return !handle || handle.done(); }
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+      T await_resume() { return handle.promise().result(); }
+    };
+    return Awaiter{handle};
+  }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+
+template <typename T> Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Eagerly started, self-destroying coroutine used to bridge a Task into
+// blocking code.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+
+template <typename T>
+DetachedTask runDetached(Task<T> task, std::promise<T> promise) {
+  try {
+    if constexpr (std::is_void_v<T>) {
+      co_await std::move(task);
+      promise.set_value();
+    } else {
+      promise.set_value(co_await std::move(task));
+    }
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+}
+
+} // namespace detail
+
+// Blocks the calling thread until the task completes. Meant for main() and
+// tests; inside coroutine code, co_await the task instead.
+template <typename T> T syncWait(Task<T> task) {
+  std::promise<T> promise;
+  std::future<T> future = promise.get_future();
+  detail::runDetached(std::move(task), std::move(promise));
+  return future.get();
+}
+
+} // namespace zuno
+
+#endif // ZUNO_TASK_HPP
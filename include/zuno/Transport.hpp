@@ -0,0 +1,87 @@
+// include/zuno/Transport.hpp
+
+#ifndef ZUNO_TRANSPORT_HPP
+#define ZUNO_TRANSPORT_HPP
+
+#include "RestClient.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace zuno {
+
+// Request as handed to a transport, after request interceptors have run.
+struct TransportRequest {
+  std::string url;
+  std::string method;
+  std::string body;
+  std::unordered_map<std::string, std::string> headers;
+  // The client's Unix socket route for the URL, if any
+  UnixSocket unixSocket;
+};
+
+// Receives response body bytes as they arrive.
+using ChunkSink = std::function<void(const std::string &)>;
+
+// Receives the status and headers once an asynchronous request is done.
+using CompletionHandler = std::function<void(BaseResponse)>;
+
+// The client's transfer loop as seen by asynchronous transports. Timers let
+// simulated delays pass without holding a thread.
+class TransportScheduler {
+public:
+  virtual ~TransportScheduler() = default;
+  // Runs fn on the loop thread at the start of the next iteration.
+  virtual void post(std::function<void()> fn) = 0;
+  // Runs fn on the loop thread once when has passed.
+  virtual void postAt(std::chrono::steady_clock::time_point when,
+                      std::function<void()> fn) = 0;
+};
+
+// Moves a request to a server and back. A client uses its built-in curl
+// transfer path until a transport is installed with setTransport(). Return
+// success = false and statusCode 0 for failures below HTTP.
+class Transport {
+public:
+  virtual ~Transport() = default;
+  virtual BaseResponse perform(const TransportRequest &request,
+                               const ChunkSink &onChunk) = 0;
+
+  // Used by the coroutine methods. Calls onChunk for each piece of the body
+  // and then onDone exactly once, from any thread but never concurrently.
+  // The client keeps the transport alive until onDone has run. The default
+  // runs perform() on a thread of its own, so a blocking transport never
+  // stalls the loop.
+  virtual void performAsync(TransportRequest request, ChunkSink onChunk,
+                            CompletionHandler onDone,
+                            TransportScheduler &scheduler);
+};
+
+// Curl transport; mainly a real backend to record from. Requests are set up
+// exactly like the client's built-in path, Unix socket routes and response
+// headers included, and share one DNS and TLS session cache. Asynchronous
+// requests run on a transfer loop of its own.
+class CurlTransport : public Transport {
+public:
+  CurlTransport();
+  ~CurlTransport() override;
+
+  BaseResponse perform(const TransportRequest &request,
+                       const ChunkSink &onChunk) override;
+  void performAsync(TransportRequest request, ChunkSink onChunk,
+                    CompletionHandler onDone,
+                    TransportScheduler &scheduler) override;
+
+private:
+  std::unique_ptr<SharedCache> cache;
+  // Started on the first asynchronous request.
+  std::unique_ptr<EventLoop> loop;
+  std::once_flag loopOnce;
+};
+
+} // namespace zuno
+
+#endif // ZUNO_TRANSPORT_HPP
@@ -0,0 +1,124 @@
+#include "zuno/Transport.hpp"
+#include "EventLoop.hpp"
+#include "RequestSetup.hpp"
+#include "SharedCache.hpp"
+#include <curl/curl.h>
+#include <iostream>
+
+namespace zuno {
+
+namespace {
+
+size_t ChunkWriteCallback(void *contents, size_t size, size_t nmemb,
+                          void *userp) {
+  size_t realSize = size * nmemb;
+  if (realSize > 0) {
+    (*static_cast<const ChunkSink *>(userp))(
+        std::string(static_cast<char *>(contents), realSize));
+  }
+  return realSize;
+}
+
+// One asynchronous request; the request data must outlive the transfer.
+struct AsyncTransfer {
+  TransportRequest request;
+  ChunkSink onChunk;
+  CompletionHandler onDone;
+  BaseResponse response{};
+  CURL *curl = nullptr;
+  struct curl_slist *headerList = nullptr;
+};
+
+// Sets up body and header collection on a handle prepared by setupHandle().
+void collectResponse(CURL *curl, const ChunkSink &onChunk,
+                     BaseResponse &response) {
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ChunkWriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &onChunk);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response.headers);
+}
+
+// Releases the handle and fills in status and success.
+void finishTransfer(CURL *curl, struct curl_slist *headerList, CURLcode res,
+                    BaseResponse &response) {
+  long httpCode = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+
+  curl_easy_cleanup(curl);
+  curl_slist_free_all(headerList);
+
+  if (res != CURLE_OK) {
+    std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
+              << std::endl;
+    response.statusCode = 0;
+    response.success = false;
+    return;
+  }
+
+  response.statusCode = static_cast<int>(httpCode);
+  response.success = (httpCode >= 200 && httpCode < 300);
+}
+
+} // namespace
+
+CurlTransport::CurlTransport() {
+  ensureCurlGlobalInit();
+  cache = std::make_unique<SharedCache>();
+}
+
+CurlTransport::~CurlTransport() {
+  // Transfers still on the loop reference the cache, so it goes after the
+  // loop.
+  EventLoop::release(std::move(loop), std::move(cache));
+}
+
+BaseResponse CurlTransport::perform(const TransportRequest &request,
+                                    const ChunkSink &onChunk) {
+  BaseResponse response{};
+  response.success = false;
+
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    return response;
+  }
+
+  struct curl_slist *chunk =
+      setupHandle(curl, request.url, request.method, request.body,
+                  request.headers, request.unixSocket, cache.get());
+  collectResponse(curl, onChunk, response);
+
+  CURLcode res = curl_easy_perform(curl);
+
+  finishTransfer(curl, chunk, res, response);
+  return response;
+}
+
+void CurlTransport::performAsync(TransportRequest request, ChunkSink onChunk,
+                                 CompletionHandler onDone,
+                                 TransportScheduler &) {
+  auto transfer = std::make_shared<AsyncTransfer>();
+  transfer->request = std::move(request);
+  transfer->onChunk = std::move(onChunk);
+  transfer->onDone = std::move(onDone);
+  transfer->response.success = false;
+
+  transfer->curl = curl_easy_init();
+  if (!transfer->curl) {
+    transfer->onDone(std::move(transfer->response));
+    return;
+  }
+
+  const TransportRequest &r = transfer->request;
+  transfer->headerList = setupHandle(transfer->curl, r.url, r.method, r.body,
+                                     r.headers, r.unixSocket, cache.get());
+  collectResponse(transfer->curl, transfer->onChunk, transfer->response);
+
+  std::call_once(loopOnce, [this]() { loop = std::make_unique<EventLoop>(); });
+  loop->add(transfer->curl, [transfer](CURLcode res) {
+    finishTransfer(transfer->curl, transfer->headerList, res,
+                   transfer->response);
+    transfer->onDone(std::move(transfer->response));
+  });
+}
+
+} // namespace zuno
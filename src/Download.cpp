@@ -0,0 +1,646 @@
+#include "zuno/RestClient.hpp"
+#include "EventLoop.hpp"
+#include "RequestSetup.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <curl/curl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace zuno {
+
+namespace {
+
+constexpr const char *kPartSuffix = ".zpart";
+// A single-stream download is written here and renamed onto the target only
+// once it succeeded, so an error response leaves an existing file alone.
+constexpr const char *kStreamSuffix = ".zdownload";
+
+// Progress is saved to the part file every time this many bytes have been
+// written, so a killed process loses at most this much work.
+constexpr std::uint64_t kCheckpointBytes = 64ull << 20;
+
+struct DownloadState;
+
+// One connection writing [start, end] of the object into the sink.
+struct RangeTransfer {
+  DownloadState *download = nullptr;
+  CURL *curl = nullptr;
+  struct curl_slist *headerList = nullptr;
+  std::uint64_t start = 0;
+  std::uint64_t end = 0;
+  std::uint64_t written = 0;
+  // False for a plain GET over a single connection
+  bool ranged = true;
+  std::fstream file;
+
+  std::uint64_t length() const { return end - start + 1; }
+  bool complete() const { return ranged && written == length(); }
+};
+
+// Shared by all ranges of one download. Only touched from the loop thread
+// while transfers are running.
+struct DownloadState {
+  std::string url;
+  std::string path;
+  std::string validator;
+  UnixSocket socket;
+  SharedCache *cache = nullptr;
+  std::uint64_t size = 0;
+  std::vector<std::unique_ptr<RangeTransfer>> ranges;
+  char *map = nullptr;
+  int fd = -1;
+  bool checkpoints = false;
+  std::uint64_t sinceCheckpoint = 0;
+  // A range request was answered with the whole object
+  bool rangesRefused = false;
+
+  std::string partPath() const { return path + kPartSuffix; }
+  void saveProgress();
+};
+
+void DownloadState::saveProgress() {
+  for (auto &range : ranges) {
+    if (range->file.is_open()) {
+      range->file.flush();
+    }
+  }
+
+  nlohmann::json progress = {{"url", url},
+                             {"size", size},
+                             {"validator", validator},
+                             {"ranges", nlohmann::json::array()}};
+  for (const auto &range : ranges) {
+    progress["ranges"].push_back({range->start, range->end, range->written});
+  }
+
+  // Write then rename, so a crash never leaves a truncated part file.
+  std::string tmpPath = partPath() + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    out << progress.dump();
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, partPath(), ec);
+  sinceCheckpoint = 0;
+}
+
+bool writeToFd(int fd, const char *data, size_t size) {
+  while (size > 0) {
+#ifdef _WIN32
+    int n = _write(fd, data, static_cast<unsigned int>(size));
+#else
+    ssize_t n = ::write(fd, data, size);
+#endif
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+size_t RangeWriteCallback(void *contents, size_t size, size_t nmemb,
+                          void *userp) {
+  size_t realSize = size * nmemb;
+  auto *range = static_cast<RangeTransfer *>(userp);
+  DownloadState *download = range->download;
+
+  long httpCode = 0;
+  curl_easy_getinfo(range->curl, CURLINFO_RESPONSE_CODE, &httpCode);
+  if (httpCode < 200 || httpCode >= 300) {
+    // Error bodies never land in the file.
+    return realSize;
+  }
+  if (range->ranged && httpCode != 206) {
+    // The server is sending the whole object; the caller falls back to a
+    // single stream.
+    download->rangesRefused = true;
+    return 0;
+  }
+
+  const char *data = static_cast<const char *>(contents);
+  if (range->ranged) {
+    if (realSize > range->length() - range->written) {
+      return 0;
+    }
+    if (download->map) {
+      std::copy(data, data + realSize,
+                download->map + range->start + range->written);
+    } else if (!range->file.write(data, realSize)) {
+      return 0;
+    }
+  } else if (download->fd >= 0) {
+    if (!writeToFd(download->fd, data, realSize)) {
+      return 0;
+    }
+  } else if (!range->file.write(data, realSize)) {
+    return 0;
+  }
+
+  range->written += realSize;
+  download->sinceCheckpoint += realSize;
+  if (download->checkpoints && download->sinceCheckpoint >= kCheckpointBytes) {
+    download->saveProgress();
+  }
+  return realSize;
+}
+
+// Discards the probe's single byte. A 2xx other than 206 means the whole
+// object is on its way, so the probe is aborted and a plain GET fetches it.
+size_t ProbeWriteCallback(void *, size_t size, size_t nmemb, void *userp) {
+  long httpCode = 0;
+  curl_easy_getinfo(static_cast<CURL *>(userp), CURLINFO_RESPONSE_CODE,
+                    &httpCode);
+  if (httpCode >= 200 && httpCode < 300 && httpCode != 206) {
+    return 0;
+  }
+  return size * nmemb;
+}
+
+// Object size from "Content-Range: bytes 0-0/<size>".
+bool contentRangeTotal(
+    const std::unordered_map<std::string, std::string> &headers,
+    std::uint64_t &size) {
+  auto it = headers.find("content-range");
+  if (it == headers.end()) {
+    return false;
+  }
+  size_t slash = it->second.rfind('/');
+  if (slash == std::string::npos || slash + 1 >= it->second.size()) {
+    return false;
+  }
+  std::string total = it->second.substr(slash + 1);
+  if (total.size() > 19 ||
+      total.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  size = std::stoull(total);
+  return true;
+}
+
+// Restores range progress from the part file if it still describes the same
+// object.
+bool loadProgress(DownloadState &download) {
+  // Without a validator there is no telling whether the bytes on disk still
+  // belong to the same object.
+  if (download.validator.empty()) {
+    return false;
+  }
+  std::ifstream in(download.partPath(), std::ios::binary);
+  if (!in) {
+    return false;
+  }
+
+  nlohmann::json progress = nlohmann::json::parse(in, nullptr, false);
+  if (progress.is_discarded() || progress.value("url", "") != download.url ||
+      progress.value("size", std::uint64_t{0}) != download.size ||
+      progress.value("validator", "") != download.validator ||
+      !progress.contains("ranges") || !progress["ranges"].is_array()) {
+    return false;
+  }
+
+  std::error_code ec;
+  if (std::filesystem::file_size(download.path, ec) != download.size || ec) {
+    return false;
+  }
+
+  // The file is not trusted: a malformed entry or one reaching past the end
+  // of the object starts the download over instead of throwing or writing
+  // outside the mapping.
+  for (const auto &entry : progress["ranges"]) {
+    if (!entry.is_array() || entry.size() != 3 ||
+        !entry[0].is_number_unsigned() || !entry[1].is_number_unsigned() ||
+        !entry[2].is_number_unsigned()) {
+      download.ranges.clear();
+      return false;
+    }
+    auto range = std::make_unique<RangeTransfer>();
+    range->start = entry[0].get<std::uint64_t>();
+    range->end = entry[1].get<std::uint64_t>();
+    if (range->start > range->end || range->end >= download.size) {
+      download.ranges.clear();
+      return false;
+    }
+    range->written = std::min(entry[2].get<std::uint64_t>(), range->length());
+    download.ranges.push_back(std::move(range));
+  }
+  return !download.ranges.empty();
+}
+
+void planRanges(DownloadState &download, const DownloadOptions &options) {
+  std::uint64_t minRange = std::max<std::uint64_t>(options.minRangeSize, 1);
+  std::uint64_t count = (download.size + minRange - 1) / minRange;
+  count = std::clamp<std::uint64_t>(count, 1, std::max(options.connections, 1u));
+
+  std::uint64_t rangeSize = download.size / count;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    auto range = std::make_unique<RangeTransfer>();
+    range->start = i * rangeSize;
+    range->end = (i + 1 == count) ? download.size - 1 : (i + 1) * rangeSize - 1;
+    download.ranges.push_back(std::move(range));
+  }
+}
+
+bool openSink(DownloadState &download, bool useMmap) {
+#ifndef _WIN32
+  if (useMmap) {
+    int fd = ::open(download.path.c_str(), O_RDWR);
+    if (fd < 0) {
+      return false;
+    }
+    void *map = ::mmap(nullptr, download.size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+      return false;
+    }
+    download.map = static_cast<char *>(map);
+    return true;
+  }
+#else
+  (void)useMmap;
+#endif
+
+  for (auto &range : download.ranges) {
+    if (range->complete()) {
+      continue;
+    }
+    range->file.open(download.path,
+                     std::ios::in | std::ios::out | std::ios::binary);
+    range->file.seekp(static_cast<std::streamoff>(range->start + range->written));
+    if (!range->file) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void closeSink(DownloadState &download) {
+  for (auto &range : download.ranges) {
+    if (range->file.is_open()) {
+      range->file.close();
+    }
+  }
+#ifndef _WIN32
+  if (download.map) {
+    ::munmap(download.map, download.size);
+    download.map = nullptr;
+  }
+#endif
+}
+
+void prepareRange(RangeTransfer &range, DownloadState &download,
+                  const std::unordered_map<std::string, std::string> &headers) {
+  range.download = &download;
+  range.curl = curl_easy_init();
+  if (!range.curl) {
+    return;
+  }
+  std::unordered_map<std::string, std::string> rangeHeaders = headers;
+  if (range.ranged && !download.validator.empty()) {
+    // If the object changed since the probe the server sends all of it
+    // instead of a range of the new version.
+    rangeHeaders["If-Range"] = download.validator;
+  }
+  range.headerList = setupHandle(range.curl, download.url, "GET", "",
+                                 rangeHeaders, download.socket, download.cache);
+  if (range.ranged) {
+    std::string bytes = std::to_string(range.start + range.written) + "-" +
+                        std::to_string(range.end);
+    curl_easy_setopt(range.curl, CURLOPT_RANGE, bytes.c_str());
+    // HTTP/2 would multiplex every range over one pooled connection, so
+    // throughput would not grow with the number of ranges.
+    curl_easy_setopt(range.curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  }
+  curl_easy_setopt(range.curl, CURLOPT_WRITEFUNCTION, RangeWriteCallback);
+  curl_easy_setopt(range.curl, CURLOPT_WRITEDATA, &range);
+}
+
+} // namespace
+
+Task<BaseResponse> RestClient::coPerformDownload(
+    std::string url, std::string path, DownloadOptions options,
+    std::unordered_map<std::string, std::string> headers) {
+
+  std::string method = "GET";
+  nlohmann::json data;
+  if (requestInterceptor) {
+    requestInterceptor->interceptRequest(url, method, data, headers);
+  }
+
+  BaseResponse response{};
+  response.success = false;
+
+  // Probe size and range support with a one-byte range GET rather than
+  // HEAD: presigned URLs are only valid for GET, and only the answer to a
+  // real range request shows that ranges work.
+  CURL *probe = curl_easy_init();
+  if (!probe) {
+    co_return response;
+  }
+  std::unordered_map<std::string, std::string> responseHeaders;
+  UnixSocket socket = unixSocketFor(url);
+  struct curl_slist *probeList =
+      setupHandle(probe, url, "GET", "", headers, socket, sharedCache.get());
+  curl_easy_setopt(probe, CURLOPT_RANGE, "0-0");
+  curl_easy_setopt(probe, CURLOPT_WRITEFUNCTION, ProbeWriteCallback);
+  curl_easy_setopt(probe, CURLOPT_WRITEDATA, probe);
+  curl_easy_setopt(probe, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(probe, CURLOPT_HEADERDATA, &responseHeaders);
+
+  CURLcode res = co_await eventLoop().transfer(probe);
+
+  long httpCode = 0;
+  curl_easy_getinfo(probe, CURLINFO_RESPONSE_CODE, &httpCode);
+  curl_easy_cleanup(probe);
+  curl_slist_free_all(probeList);
+
+  if (httpCode == 0) {
+    std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
+              << std::endl;
+    co_return response;
+  }
+
+  std::uint64_t size = 0;
+  bool ranged = res == CURLE_OK && httpCode == 206 &&
+                contentRangeTotal(responseHeaders, size) && size > 0;
+
+  DownloadState download;
+  download.url = url;
+  download.path = path;
+  download.socket = socket;
+  download.cache = sharedCache.get();
+  download.size = ranged ? size : 0;
+  // If-Range only accepts a strong ETag, so a weak one falls back to
+  // Last-Modified.
+  if (auto it = responseHeaders.find("etag");
+      it != responseHeaders.end() && it->second.rfind("W/", 0) != 0) {
+    download.validator = it->second;
+  } else if (auto lm = responseHeaders.find("last-modified");
+             lm != responseHeaders.end()) {
+    download.validator = lm->second;
+  }
+  bool resumable = options.resume && !download.validator.empty();
+
+  bool ok = false;
+  long status = 0;
+
+  if (ranged) {
+    if (!resumable || !loadProgress(download)) {
+      download.ranges.clear();
+      std::ofstream(path, std::ios::binary | std::ios::trunc);
+      std::error_code ec;
+      std::filesystem::resize_file(path, download.size, ec);
+      if (ec) {
+        std::cerr << "Failed to allocate " << path << ": " << ec.message()
+                  << std::endl;
+        co_return response;
+      }
+      planRanges(download, options);
+    }
+    download.checkpoints = resumable;
+
+    if (!openSink(download, options.useMmap)) {
+      std::cerr << "Failed to open " << path << " for writing" << std::endl;
+      closeSink(download);
+      co_return response;
+    }
+
+    std::vector<CURL *> handles;
+    std::vector<RangeTransfer *> active;
+    bool prepared = true;
+    for (auto &range : download.ranges) {
+      if (range->complete()) {
+        continue;
+      }
+      prepareRange(*range, download, headers);
+      if (!range->curl) {
+        prepared = false;
+        continue;
+      }
+      handles.push_back(range->curl);
+      active.push_back(range.get());
+    }
+
+    std::vector<CURLcode> results(active.size(), CURLE_FAILED_INIT);
+    if (prepared) {
+      results = co_await eventLoop().transferAll(handles);
+    }
+
+    ok = true;
+    status = 200;
+    for (size_t i = 0; i < active.size(); ++i) {
+      RangeTransfer &range = *active[i];
+      long rangeCode = 0;
+      curl_easy_getinfo(range.curl, CURLINFO_RESPONSE_CODE, &rangeCode);
+      curl_easy_cleanup(range.curl);
+      curl_slist_free_all(range.headerList);
+      range.curl = nullptr;
+      range.headerList = nullptr;
+
+      if (results[i] != CURLE_OK && !download.rangesRefused) {
+        std::cerr << "curl_easy_perform() failed: "
+                  << curl_easy_strerror(results[i]) << std::endl;
+      }
+      if (ok && (results[i] != CURLE_OK || !range.complete())) {
+        // Report the first failing range: 0 when its transfer failed, as on
+        // the other failure paths, otherwise its HTTP status.
+        status = results[i] != CURLE_OK ? 0 : rangeCode;
+        ok = false;
+      }
+    }
+
+    closeSink(download);
+
+    if (download.rangesRefused) {
+      // The server sent the whole object after all, because it changed
+      // since the probe or ignores ranges. Start over with a single stream.
+      std::error_code ec;
+      std::filesystem::remove(download.partPath(), ec);
+      download.ranges.clear();
+      ranged = false;
+    } else if (ok) {
+      std::error_code ec;
+      std::filesystem::remove(download.partPath(), ec);
+      // Describe the whole object rather than the one-byte probe range.
+      responseHeaders.erase("content-range");
+      responseHeaders["content-length"] = std::to_string(download.size);
+    } else if (resumable) {
+      download.saveProgress();
+    }
+  }
+
+  if (!ranged) {
+    // Single connection; no way to resume without range support.
+    download.path = path + kStreamSuffix;
+    std::ofstream(download.path, std::ios::binary | std::ios::trunc);
+    auto range = std::make_unique<RangeTransfer>();
+    range->ranged = false;
+    download.ranges.push_back(std::move(range));
+    RangeTransfer &single = *download.ranges.back();
+
+    std::error_code ec;
+    if (!openSink(download, false)) {
+      std::cerr << "Failed to open " << download.path << " for writing"
+                << std::endl;
+      closeSink(download);
+      std::filesystem::remove(download.path, ec);
+      co_return response;
+    }
+    prepareRange(single, download, headers);
+    if (!single.curl) {
+      closeSink(download);
+      std::filesystem::remove(download.path, ec);
+      co_return response;
+    }
+    responseHeaders.clear();
+    curl_easy_setopt(single.curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(single.curl, CURLOPT_HEADERDATA, &responseHeaders);
+
+    res = co_await eventLoop().transfer(single.curl);
+
+    curl_easy_getinfo(single.curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_cleanup(single.curl);
+    curl_slist_free_all(single.headerList);
+    single.curl = nullptr;
+    single.headerList = nullptr;
+    closeSink(download);
+
+    if (res != CURLE_OK) {
+      std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
+                << std::endl;
+    }
+    ok = res == CURLE_OK && status >= 200 && status < 300;
+    if (ok) {
+      std::filesystem::rename(download.path, path, ec);
+      if (ec) {
+        std::cerr << "Failed to move the download onto " << path << ": "
+                  << ec.message() << std::endl;
+        ok = false;
+      }
+    }
+    if (!ok) {
+      std::filesystem::remove(download.path, ec);
+    }
+  }
+
+  response.statusCode = static_cast<int>(status);
+  response.success = ok;
+  response.headers = std::move(responseHeaders);
+  interceptResponse(responseInterceptor.get(), url, method, data, headers,
+                    response);
+
+  co_return response;
+}
+
+Task<BaseResponse> RestClient::coPerformFdDownload(
+    std::string url, int fd,
+    std::unordered_map<std::string, std::string> headers) {
+
+  std::string method = "GET";
+  nlohmann::json data;
+  if (requestInterceptor) {
+    requestInterceptor->interceptRequest(url, method, data, headers);
+  }
+
+  BaseResponse response{};
+  response.success = false;
+
+  DownloadState download;
+  download.url = url;
+  download.socket = unixSocketFor(url);
+  download.cache = sharedCache.get();
+  download.fd = fd;
+
+  RangeTransfer range;
+  range.ranged = false;
+  prepareRange(range, download, headers);
+  if (!range.curl) {
+    co_return response;
+  }
+  curl_easy_setopt(range.curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(range.curl, CURLOPT_HEADERDATA, &response.headers);
+
+  CURLcode res = co_await eventLoop().transfer(range.curl);
+
+  long httpCode = 0;
+  curl_easy_getinfo(range.curl, CURLINFO_RESPONSE_CODE, &httpCode);
+  curl_easy_cleanup(range.curl);
+  curl_slist_free_all(range.headerList);
+
+  if (res != CURLE_OK) {
+    std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
+              << std::endl;
+    co_return response;
+  }
+
+  response.statusCode = static_cast<int>(httpCode);
+  response.success = (httpCode >= 200 && httpCode < 300);
+  interceptResponse(responseInterceptor.get(), url, method, data, headers,
+                    response);
+
+  co_return response;
+}
+
+// Downloads
+BaseResponse RestClient::download(
+    const std::string &url, const std::string &path,
+    const DownloadOptions &options,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return syncWait(coPerformDownload(url, path, options, headers));
+}
+
+BaseResponse RestClient::download(
+    const std::string &url, int fd,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return syncWait(coPerformFdDownload(url, fd, headers));
+}
+
+std::future<BaseResponse> RestClient::downloadAsync(
+    const std::string &url, const std::string &path,
+    const DownloadOptions &options,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return std::async(std::launch::async, [this, url, path, options, headers]() {
+    return download(url, path, options, headers);
+  });
+}
+
+std::future<BaseResponse> RestClient::downloadAsync(
+    const std::string &url, int fd,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return std::async(std::launch::async, [this, url, fd, headers]() {
+    return download(url, fd, headers);
+  });
+}
+
+Task<BaseResponse> RestClient::co_download(
+    const std::string &url, const std::string &path,
+    const DownloadOptions &options,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformDownload(url, path, options, headers);
+}
+
+Task<BaseResponse> RestClient::co_download(
+    const std::string &url, int fd,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformFdDownload(url, fd, headers);
+}
+
+} // namespace zuno
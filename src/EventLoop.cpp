@@ -0,0 +1,198 @@
+#include "EventLoop.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace zuno {
+
+namespace {
+
+// Idle connections kept for reuse. curl's default scales with the number of
+// running transfers, which would drop prewarmed connections as soon as
+// traffic is light.
+constexpr long kMaxIdleConnections = 64;
+
+// Loops detached by release() that have not finished tearing down.
+std::atomic<int> detachedLoops{0};
+
+// Longest wait in curl_multi_poll; also bounds how late a stop is noticed.
+constexpr auto kMaxPoll = std::chrono::milliseconds(1000);
+
+} // namespace
+
+EventLoop::EventLoop() : multi(curl_multi_init()) {
+  curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, kMaxIdleConnections);
+  thread = std::thread(&EventLoop::run, this);
+}
+
+EventLoop::~EventLoop() {
+  stopping = true;
+  if (thread.joinable()) {
+    curl_multi_wakeup(multi);
+    thread.join();
+  }
+
+  // Anything still queued, timed or in flight is run or aborted so awaiting
+  // coroutines are resumed instead of leaked. Those may queue more work, so
+  // repeat until nothing is left.
+  std::vector<std::function<void()>> tasks;
+  for (;;) {
+    takeDue(tasks, std::chrono::steady_clock::time_point::max());
+    if (tasks.empty() && active.empty()) {
+      break;
+    }
+    for (auto &task : tasks) {
+      task();
+    }
+    tasks.clear();
+    while (!active.empty()) {
+      complete(active.begin()->first, CURLE_ABORTED_BY_CALLBACK);
+    }
+  }
+
+  curl_multi_cleanup(multi);
+}
+
+void EventLoop::release(std::unique_ptr<EventLoop> loop,
+                        std::shared_ptr<void> keepAlive) {
+  if (!loop || std::this_thread::get_id() != loop->thread.get_id()) {
+    loop.reset();
+    return;
+  }
+
+  // Only the loop thread reads detached, so no synchronization is needed.
+  EventLoop *self = loop.release();
+  self->keepAlive = std::move(keepAlive);
+  self->detached = true;
+  self->stopping = true;
+  self->thread.detach();
+  ++detachedLoops;
+}
+
+void EventLoop::waitForDetached() {
+  while (detachedLoops.load() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+std::uint64_t EventLoop::add(CURL *easy, DoneCallback onDone) {
+  std::uint64_t id = nextId++;
+  post([this, easy, id, onDone = std::move(onDone)]() mutable {
+    CURLMcode rc = curl_multi_add_handle(multi, easy);
+    if (rc != CURLM_OK) {
+      std::cerr << "curl_multi_add_handle() failed: " << curl_multi_strerror(rc)
+                << std::endl;
+      onDone(CURLE_FAILED_INIT);
+      return;
+    }
+    active.emplace(easy, Entry{id, std::move(onDone)});
+  });
+  return id;
+}
+
+void EventLoop::cancel(std::uint64_t id) {
+  post([this, id]() {
+    for (const auto &entry : active) {
+      if (entry.second.id == id) {
+        complete(entry.first, CURLE_ABORTED_BY_CALLBACK);
+        return;
+      }
+    }
+  });
+}
+
+void EventLoop::post(std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(std::move(fn));
+  }
+  curl_multi_wakeup(multi);
+}
+
+void EventLoop::postAt(std::chrono::steady_clock::time_point when,
+                       std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    timers.push_back({when, timerSequence++, std::move(fn)});
+    std::push_heap(timers.begin(), timers.end(), std::greater<>());
+  }
+  curl_multi_wakeup(multi);
+}
+
+void EventLoop::takeDue(std::vector<std::function<void()>> &tasks,
+                        std::chrono::steady_clock::time_point until) {
+  std::lock_guard<std::mutex> lock(mutex);
+  tasks.swap(pending);
+  while (!timers.empty() && timers.front().when <= until) {
+    std::pop_heap(timers.begin(), timers.end(), std::greater<>());
+    tasks.push_back(std::move(timers.back().fn));
+    timers.pop_back();
+  }
+}
+
+void EventLoop::complete(CURL *easy, CURLcode code) {
+  auto it = active.find(easy);
+  if (it == active.end()) {
+    return;
+  }
+  DoneCallback onDone = std::move(it->second.onDone);
+  active.erase(it);
+  curl_multi_remove_handle(multi, easy);
+  onDone(code);
+}
+
+void EventLoop::run() {
+  std::vector<std::function<void()>> tasks;
+
+  while (!stopping) {
+    takeDue(tasks, std::chrono::steady_clock::now());
+    for (auto &task : tasks) {
+      task();
+    }
+    tasks.clear();
+
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    CURLMsg *msg;
+    int queued = 0;
+    while ((msg = curl_multi_info_read(multi, &queued))) {
+      if (msg->msg == CURLMSG_DONE) {
+        complete(msg->easy_handle, msg->data.result);
+      }
+    }
+
+    auto wait = std::chrono::steady_clock::duration(kMaxPoll);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!pending.empty()) {
+        continue;
+      }
+      if (!timers.empty()) {
+        wait = std::min(wait, timers.front().when -
+                                  std::chrono::steady_clock::now());
+      }
+    }
+    if (wait < std::chrono::milliseconds(1)) {
+      // curl_multi_poll counts in milliseconds, so short waits for a timer
+      // are slept instead.
+      if (wait.count() > 0) {
+        std::this_thread::sleep_for(wait);
+      }
+      continue;
+    }
+    curl_multi_poll(
+        multi, nullptr, 0,
+        static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wait)
+                .count()),
+        nullptr);
+  }
+
+  if (detached) {
+    delete this;
+    --detachedLoops;
+  }
+}
+
+} // namespace zuno
@@ -0,0 +1,158 @@
+// src/EventLoop.hpp
+
+#ifndef ZUNO_EVENTLOOP_H
+#define ZUNO_EVENTLOOP_H
+
+#include "zuno/Transport.hpp"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <curl/curl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace zuno {
+
+// Drives easy handles through a single curl multi handle on a background
+// thread. Completion callbacks run on that thread, after the handle has been
+// removed from the multi handle, so they may clean it up or start new
+// transfers. Also the scheduler handed to asynchronous transports.
+class EventLoop : public TransportScheduler {
+public:
+  using DoneCallback = std::function<void(CURLcode)>;
+
+  EventLoop();
+  ~EventLoop() override;
+
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+
+  // Stops and destroys a loop, then releases keepAlive. Called from the
+  // loop's own thread (a coroutine resumed there destroying its client) the
+  // thread cannot be joined, so it is detached and tears the loop down
+  // itself once the running callback returns.
+  static void release(std::unique_ptr<EventLoop> loop,
+                      std::shared_ptr<void> keepAlive = {});
+
+  // Blocks until every detached loop has finished tearing down. Called
+  // before libcurl's global cleanup at process exit.
+  static void waitForDetached();
+
+  // Queues an easy handle for transfer and returns an id usable with cancel().
+  std::uint64_t add(CURL *easy, DoneCallback onDone);
+
+  // Aborts a transfer; its callback runs with CURLE_ABORTED_BY_CALLBACK. Does
+  // nothing if the transfer already finished.
+  void cancel(std::uint64_t id);
+
+  // Runs fn on the loop thread at the start of the next iteration.
+  void post(std::function<void()> fn) override;
+
+  // Runs fn on the loop thread once when has passed. Timers still pending
+  // when the loop is destroyed fire early.
+  void postAt(std::chrono::steady_clock::time_point when,
+              std::function<void()> fn) override;
+
+  // Awaitable that suspends the caller until the transfer finishes and then
+  // resumes it on the loop thread.
+  auto transfer(CURL *easy) {
+    struct Awaiter {
+      EventLoop &loop;
+      CURL *easy;
+      CURLcode result = CURLE_OK;
+
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) {
+        // The loop may resume the coroutine before add() returns, so nothing
+        // below may touch the awaiter.
+        loop.add(easy, [this, handle](CURLcode code) {
+          result = code;
+          handle.resume();
+        });
+      }
+      CURLcode await_resume() const noexcept { return result; }
+    };
+    return Awaiter{*this, easy};
+  }
+
+  // Runs several transfers concurrently and resumes the caller once all of
+  // them have finished, with one result per handle.
+  auto transferAll(std::vector<CURL *> handles) {
+    struct Awaiter {
+      EventLoop &loop;
+      std::vector<CURL *> handles;
+      std::vector<CURLcode> results;
+      size_t remaining = 0;
+
+      bool await_ready() const noexcept { return handles.empty(); }
+      void await_suspend(std::coroutine_handle<> handle) {
+        const size_t count = handles.size();
+        results.assign(count, CURLE_OK);
+        remaining = count;
+        // The caller cannot be resumed before the last handle has been
+        // added, but after that nothing may touch the awaiter, not even the
+        // loop condition.
+        CURL *const *easy = handles.data();
+        EventLoop &target = loop;
+        for (size_t i = 0; i < count; ++i) {
+          target.add(easy[i], [this, i, handle](CURLcode code) {
+            results[i] = code;
+            if (--remaining == 0) {
+              handle.resume();
+            }
+          });
+        }
+      }
+      std::vector<CURLcode> await_resume() { return std::move(results); }
+    };
+    return Awaiter{*this, std::move(handles), {}};
+  }
+
+private:
+  struct Entry {
+    std::uint64_t id;
+    DoneCallback onDone;
+  };
+
+  struct Timer {
+    std::chrono::steady_clock::time_point when;
+    std::uint64_t sequence;
+    std::function<void()> fn;
+    // Heap order: earliest first, then in the order posted.
+    bool operator>(const Timer &other) const {
+      return when != other.when ? when > other.when : sequence > other.sequence;
+    }
+  };
+
+  void run();
+  void complete(CURL *easy, CURLcode code);
+  // Moves posted tasks and the timers due by until into tasks.
+  void takeDue(std::vector<std::function<void()>> &tasks,
+               std::chrono::steady_clock::time_point until);
+
+  CURLM *multi;
+  std::thread thread;
+  std::atomic<bool> stopping{false};
+  // Set by release() on the loop thread; run() then deletes the loop.
+  bool detached = false;
+  std::shared_ptr<void> keepAlive;
+  std::atomic<std::uint64_t> nextId{1};
+
+  std::mutex mutex;
+  std::vector<std::function<void()>> pending;
+  // Min-heap on (when, sequence), so timers due together run in order
+  std::vector<Timer> timers;
+  std::uint64_t timerSequence = 0;
+
+  // Only touched from the loop thread.
+  std::unordered_map<CURL *, Entry> active;
+};
+
+} // namespace zuno
+
+#endif // ZUNO_EVENTLOOP_H
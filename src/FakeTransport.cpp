@@ -0,0 +1,208 @@
+#include "zuno/FakeTransport.hpp"
+#include "RequestSetup.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace zuno {
+
+namespace {
+
+// splitmix64 finalizer; turns a seed and a request number into independent
+// engine seeds.
+std::uint64_t mix(std::uint64_t value) {
+  value += 0x9e3779b97f4a7c15ULL;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+// Splits a body into chunks of chunkSize bytes, each due once bandwidth
+// allows; unlimited bandwidth makes everything due at start.
+std::vector<TimedChunk> splitBody(std::string body,
+                                  std::chrono::steady_clock::time_point start,
+                                  size_t chunkSize, double bandwidth) {
+  std::vector<TimedChunk> chunks;
+  chunkSize = std::max<size_t>(chunkSize, 1);
+  if (bandwidth <= 0 && body.size() <= chunkSize) {
+    if (!body.empty()) {
+      chunks.push_back({start, std::move(body)});
+    }
+    return chunks;
+  }
+
+  chunks.reserve((body.size() + chunkSize - 1) / chunkSize);
+  for (size_t offset = 0; offset < body.size(); offset += chunkSize) {
+    size_t end = std::min(offset + chunkSize, body.size());
+    auto due = start;
+    if (bandwidth > 0) {
+      due += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(end / bandwidth));
+    }
+    chunks.push_back({due, body.substr(offset, end - offset)});
+  }
+  return chunks;
+}
+
+BaseResponse toBaseResponse(HttpResponse &result) {
+  BaseResponse response{};
+  response.statusCode = result.statusCode;
+  response.headers = std::move(result.headers);
+  response.success = (result.statusCode >= 200 && result.statusCode < 300);
+  return response;
+}
+
+} // namespace
+
+FakeTransport::FakeTransport() : FakeTransport(Responder{}, Profile{}) {}
+
+FakeTransport::FakeTransport(Responder responder)
+    : FakeTransport(std::move(responder), Profile{}) {}
+
+FakeTransport::FakeTransport(Responder responder, Profile profile)
+    : responder(std::move(responder)), profile(std::move(profile)),
+      randomized(this->profile.latency || this->profile.errorRate > 0 ||
+                 this->profile.httpErrorRate > 0) {}
+
+FakeTransport::Draw FakeTransport::draw() {
+  std::uint64_t n = requests.fetch_add(1, std::memory_order_relaxed);
+  Draw result;
+  if (!randomized) {
+    return result;
+  }
+
+  // Derived per request, so the outcome depends only on the seed and the
+  // request's position, not on which thread sent it. The coins come straight
+  // from splitmix64; an engine is only seeded when latency needs one.
+  std::uint64_t state = mix(profile.seed ^ mix(n));
+  auto coin = [&state]() {
+    state = mix(state);
+    return static_cast<double>(state >> 11) * 0x1.0p-53;
+  };
+  if (profile.latency) {
+    std::mt19937_64 engine(state);
+    result.latency = profile.latency(engine);
+  }
+  result.connectionError =
+      profile.errorRate > 0 && coin() < profile.errorRate;
+  result.httpError = !result.connectionError && profile.httpErrorRate > 0 &&
+                     coin() < profile.httpErrorRate;
+  return result;
+}
+
+bool FakeTransport::respond(const TransportRequest &request,
+                            const Draw &random, HttpResponse &result) {
+  if (random.connectionError) {
+    return false;
+  }
+
+  if (random.httpError) {
+    result.statusCode = profile.errorStatus;
+  } else if (responder) {
+    // success is derived from the status; responders often leave it unset.
+    HttpResponse answer = responder(request);
+    result.statusCode = answer.statusCode;
+    result.headers = std::move(answer.headers);
+    result.body = std::move(answer.body);
+  } else {
+    result.statusCode = 200;
+  }
+  return true;
+}
+
+BaseResponse FakeTransport::perform(const TransportRequest &request,
+                                    const ChunkSink &onChunk) {
+  Draw random = draw();
+  if (random.latency.count() > 0) {
+    std::this_thread::sleep_for(random.latency);
+  }
+
+  HttpResponse result{};
+  if (!respond(request, random, result)) {
+    BaseResponse response{};
+    response.success = false;
+    return response;
+  }
+
+  if (profile.bandwidth <= 0 &&
+      result.body.size() <= std::max<size_t>(profile.chunkSize, 1)) {
+    // The common load-test case, kept free of allocations.
+    if (!result.body.empty()) {
+      onChunk(result.body);
+    }
+    return toBaseResponse(result);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto &chunk : splitBody(std::move(result.body), start,
+                               profile.chunkSize, profile.bandwidth)) {
+    if (chunk.due > start) {
+      std::this_thread::sleep_until(chunk.due);
+    }
+    onChunk(chunk.data);
+  }
+  return toBaseResponse(result);
+}
+
+void FakeTransport::performAsync(TransportRequest request, ChunkSink onChunk,
+                                 CompletionHandler onDone,
+                                 TransportScheduler &scheduler) {
+  Draw random = draw();
+  auto start = std::chrono::steady_clock::now() + random.latency;
+
+  HttpResponse result{};
+  BaseResponse response{};
+  response.success = false;
+  std::vector<TimedChunk> chunks;
+  if (respond(request, random, result)) {
+    chunks = splitBody(std::move(result.body), start, profile.chunkSize,
+                       profile.bandwidth);
+    response = toBaseResponse(result);
+  }
+
+  // Latency and bandwidth are timers on the client's loop, so waiting
+  // requests hold no thread.
+  deliverChunks(scheduler, std::move(chunks), start, std::move(onChunk),
+                [onDone = std::move(onDone),
+                 response = std::move(response)]() mutable {
+                  onDone(std::move(response));
+                });
+}
+
+FakeTransport::LatencyDistribution
+FakeTransport::fixedLatency(std::chrono::microseconds value) {
+  return [value](std::mt19937_64 &) { return value; };
+}
+
+FakeTransport::LatencyDistribution
+FakeTransport::uniformLatency(std::chrono::microseconds min,
+                              std::chrono::microseconds max) {
+  return [min, max](std::mt19937_64 &random) {
+    std::uniform_int_distribution<std::int64_t> dist(min.count(), max.count());
+    return std::chrono::microseconds(dist(random));
+  };
+}
+
+FakeTransport::LatencyDistribution
+FakeTransport::normalLatency(std::chrono::microseconds mean,
+                             std::chrono::microseconds stddev) {
+  return [mean, stddev](std::mt19937_64 &random) {
+    std::normal_distribution<double> dist(static_cast<double>(mean.count()),
+                                          static_cast<double>(stddev.count()));
+    return std::chrono::microseconds(
+        static_cast<std::int64_t>(std::max(0.0, dist(random))));
+  };
+}
+
+FakeTransport::LatencyDistribution
+FakeTransport::logNormalLatency(std::chrono::microseconds median,
+                                double sigma) {
+  return [median, sigma](std::mt19937_64 &random) {
+    std::lognormal_distribution<double> dist(
+        std::log(static_cast<double>(std::max<std::int64_t>(median.count(), 1))),
+        sigma);
+    return std::chrono::microseconds(static_cast<std::int64_t>(dist(random)));
+  };
+}
+
+} // namespace zuno
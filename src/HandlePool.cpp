@@ -0,0 +1,64 @@
+#include "HandlePool.hpp"
+#include "SharedCache.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace zuno {
+
+namespace {
+
+// Idle handles kept per client. Each may hold a few open connections, so
+// this bounds the sockets a burst of blocking callers leaves behind.
+constexpr size_t kMaxIdleHandles = 16;
+
+} // namespace
+
+HandlePool::HandlePool(std::shared_ptr<SharedCache> cache)
+    : cache(std::move(cache)) {}
+
+HandlePool::~HandlePool() {
+  for (auto &entry : idle) {
+    curl_easy_cleanup(entry.curl);
+  }
+}
+
+CURL *HandlePool::acquire(const std::string &origin) {
+  CURL *curl = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!idle.empty()) {
+      // The newest handle for this origin, or else the newest one.
+      auto match = std::find_if(idle.rbegin(), idle.rend(),
+                                [&origin](const Idle &entry) {
+                                  return entry.origin == origin;
+                                });
+      auto it = match != idle.rend() ? std::prev(match.base()) : idle.end() - 1;
+      curl = it->curl;
+      idle.erase(it);
+    }
+  }
+
+  if (!curl) {
+    return curl_easy_init();
+  }
+  // Drops the previous request's options but keeps its connections.
+  curl_easy_reset(curl);
+  return curl;
+}
+
+void HandlePool::release(CURL *curl, const std::string &origin) {
+  CURL *evicted = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (idle.size() >= kMaxIdleHandles) {
+      evicted = idle.front().curl;
+      idle.erase(idle.begin());
+    }
+    idle.push_back({origin, curl});
+  }
+  if (evicted) {
+    curl_easy_cleanup(evicted);
+  }
+}
+
+} // namespace zuno
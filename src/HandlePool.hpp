@@ -0,0 +1,49 @@
+// src/HandlePool.hpp
+
+#ifndef ZUNO_HANDLEPOOL_H
+#define ZUNO_HANDLEPOOL_H
+
+#include <curl/curl.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace zuno {
+
+class SharedCache;
+
+// Idle easy handles for the blocking request methods of one client. A
+// handle keeps its connections open between requests, so a caller that
+// borrows one reuses a warm connection instead of paying the TCP connect and
+// TLS handshake again. Handles are used by one thread at a time.
+class HandlePool {
+public:
+  // Keeps cache alive until the handles attached to it are gone.
+  explicit HandlePool(std::shared_ptr<SharedCache> cache);
+  ~HandlePool();
+
+  HandlePool(const HandlePool &) = delete;
+  HandlePool &operator=(const HandlePool &) = delete;
+
+  // A reset handle, preferably one that last talked to origin; nullptr if
+  // none could be created.
+  CURL *acquire(const std::string &origin);
+  // Returns a handle after a request to origin.
+  void release(CURL *curl, const std::string &origin);
+
+private:
+  struct Idle {
+    std::string origin;
+    CURL *curl;
+  };
+
+  std::shared_ptr<SharedCache> cache;
+  std::mutex mutex;
+  // Most recently released last
+  std::vector<Idle> idle;
+};
+
+} // namespace zuno
+
+#endif // ZUNO_HANDLEPOOL_H
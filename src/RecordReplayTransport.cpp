@@ -0,0 +1,327 @@
+#include "zuno/RecordReplayTransport.hpp"
+#include "RequestSetup.hpp"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+namespace zuno {
+
+namespace {
+
+// File layout: the magic, an exchange count, then per exchange method, URL,
+// request body, status, success flag, headers and timed chunks. Integers are
+// LEB128 varints and strings are length-prefixed.
+constexpr char kMagic[4] = {'Z', 'R', 'R', '1'};
+
+void writeVarint(std::string &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void writeString(std::string &out, const std::string &value) {
+  writeVarint(out, value.size());
+  out.append(value);
+}
+
+class Reader {
+public:
+  explicit Reader(const std::string &data) : data(data) {}
+
+  bool readVarint(std::uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos >= data.size()) {
+        return false;
+      }
+      auto byte = static_cast<unsigned char>(data[pos++]);
+      value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool readString(std::string &value) {
+    std::uint64_t size;
+    if (!readVarint(size) || size > data.size() - pos) {
+      return false;
+    }
+    value.assign(data, pos, size);
+    pos += size;
+    return true;
+  }
+
+  bool readBytes(const char *expected, size_t size) {
+    if (data.compare(pos, size, expected, size) != 0) {
+      return false;
+    }
+    pos += size;
+    return true;
+  }
+
+private:
+  const std::string &data;
+  size_t pos = 0;
+};
+
+} // namespace
+
+RecordReplayTransport::RecordReplayTransport(std::shared_ptr<Transport> inner)
+    : inner(std::move(inner)) {}
+
+RecordReplayTransport::RecordReplayTransport(const std::string &path) {
+  if (!load(path)) {
+    std::cerr << "Failed to load recordings from " << path << std::endl;
+  }
+}
+
+std::string RecordReplayTransport::keyOf(const std::string &method,
+                                         const std::string &url,
+                                         const std::string &body) {
+  std::string key;
+  key.reserve(method.size() + url.size() + body.size() + 2);
+  key.append(method).append(1, '\0').append(url).append(1, '\0').append(body);
+  return key;
+}
+
+void RecordReplayTransport::record(Exchange exchange) {
+  std::string key = keyOf(exchange.method, exchange.url, exchange.body);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = recordings[key];
+  if (!slot) {
+    slot = std::make_unique<Recordings>();
+    keyOrder.push_back(key);
+  }
+  slot->exchanges.push_back(std::move(exchange));
+}
+
+// Replay: the table is only written by load() during construction, so no
+// locking on the hot path.
+const RecordReplayTransport::Exchange *
+RecordReplayTransport::find(const TransportRequest &request) {
+  auto it = recordings.find(keyOf(request.method, request.url, request.body));
+  if (it == recordings.end()) {
+    std::cerr << "No recorded response for " << request.method << " "
+              << request.url << std::endl;
+    return nullptr;
+  }
+
+  Recordings &recorded = *it->second;
+  return &recorded.exchanges[recorded.next.fetch_add(
+                                 1, std::memory_order_relaxed) %
+                             recorded.exchanges.size()];
+}
+
+BaseResponse RecordReplayTransport::replayedResponse(const Exchange *exchange) {
+  BaseResponse response{};
+  response.success = false;
+  if (exchange) {
+    response.statusCode = exchange->statusCode;
+    response.success = exchange->success;
+    response.headers = exchange->headers;
+  }
+  return response;
+}
+
+BaseResponse RecordReplayTransport::perform(const TransportRequest &request,
+                                            const ChunkSink &onChunk) {
+  if (inner) {
+    Exchange exchange;
+    exchange.method = request.method;
+    exchange.url = request.url;
+    exchange.body = request.body;
+
+    auto start = std::chrono::steady_clock::now();
+    BaseResponse response =
+        inner->perform(request, [&](const std::string &data) {
+          exchange.chunks.push_back(
+              {std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start),
+               data});
+          onChunk(data);
+        });
+
+    exchange.statusCode = response.statusCode;
+    exchange.success = response.success;
+    exchange.headers = response.headers;
+    record(std::move(exchange));
+    return response;
+  }
+
+  const Exchange *exchange = find(request);
+  if (exchange) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &chunk : exchange->chunks) {
+      if (replayTiming) {
+        std::this_thread::sleep_until(start + chunk.offset);
+      }
+      onChunk(chunk.data);
+    }
+  }
+  return replayedResponse(exchange);
+}
+
+void RecordReplayTransport::performAsync(TransportRequest request,
+                                         ChunkSink onChunk,
+                                         CompletionHandler onDone,
+                                         TransportScheduler &scheduler) {
+  if (inner) {
+    auto exchange = std::make_shared<Exchange>();
+    exchange->method = request.method;
+    exchange->url = request.url;
+    exchange->body = request.body;
+
+    auto start = std::chrono::steady_clock::now();
+    inner->performAsync(
+        std::move(request),
+        [exchange, start, onChunk = std::move(onChunk)](const std::string &data) {
+          exchange->chunks.push_back(
+              {std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start),
+               data});
+          onChunk(data);
+        },
+        // The client keeps this transport alive until onDone has run.
+        [this, exchange, onDone = std::move(onDone)](BaseResponse response) {
+          exchange->statusCode = response.statusCode;
+          exchange->success = response.success;
+          exchange->headers = response.headers;
+          record(std::move(*exchange));
+          onDone(std::move(response));
+        },
+        scheduler);
+    return;
+  }
+
+  const Exchange *exchange = find(request);
+  if (!exchange || !replayTiming) {
+    if (exchange) {
+      for (const auto &chunk : exchange->chunks) {
+        onChunk(chunk.data);
+      }
+    }
+    onDone(replayedResponse(exchange));
+    return;
+  }
+
+  // Recorded gaps become timers on the client's loop.
+  auto start = std::chrono::steady_clock::now();
+  std::vector<TimedChunk> chunks;
+  chunks.reserve(exchange->chunks.size());
+  for (const auto &chunk : exchange->chunks) {
+    chunks.push_back({start + chunk.offset, chunk.data});
+  }
+  deliverChunks(scheduler, std::move(chunks), start, std::move(onChunk),
+                [onDone = std::move(onDone),
+                 response = replayedResponse(exchange)]() mutable {
+                  onDone(std::move(response));
+                });
+}
+
+bool RecordReplayTransport::save(const std::string &path) const {
+  std::string out(kMagic, sizeof(kMagic));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto &entry : recordings) {
+      count += entry.second->exchanges.size();
+    }
+    writeVarint(out, count);
+
+    for (const auto &key : keyOrder) {
+      for (const auto &exchange : recordings.at(key)->exchanges) {
+        writeString(out, exchange.method);
+        writeString(out, exchange.url);
+        writeString(out, exchange.body);
+        writeVarint(out, static_cast<std::uint64_t>(exchange.statusCode));
+        writeVarint(out, exchange.success ? 1 : 0);
+        writeVarint(out, exchange.headers.size());
+        for (const auto &header : exchange.headers) {
+          writeString(out, header.first);
+          writeString(out, header.second);
+        }
+        writeVarint(out, exchange.chunks.size());
+        for (const auto &chunk : exchange.chunks) {
+          writeVarint(out, static_cast<std::uint64_t>(chunk.offset.count()));
+          writeString(out, chunk.data);
+        }
+      }
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(out.data(), static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(file);
+}
+
+bool RecordReplayTransport::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+
+  Reader reader(data);
+  std::uint64_t count;
+  if (!reader.readBytes(kMagic, sizeof(kMagic)) || !reader.readVarint(count)) {
+    return false;
+  }
+
+  std::unordered_map<std::string, std::unique_ptr<Recordings>> loaded;
+  std::vector<std::string> order;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Exchange exchange;
+    std::uint64_t status, headerCount, chunkCount;
+    if (!reader.readString(exchange.method) || !reader.readString(exchange.url) ||
+        !reader.readString(exchange.body) || !reader.readVarint(status)) {
+      return false;
+    }
+    std::uint64_t successFlag;
+    if (!reader.readVarint(successFlag) || !reader.readVarint(headerCount)) {
+      return false;
+    }
+    exchange.statusCode = static_cast<int>(status);
+    exchange.success = successFlag != 0;
+
+    for (std::uint64_t h = 0; h < headerCount; ++h) {
+      std::string name, value;
+      if (!reader.readString(name) || !reader.readString(value)) {
+        return false;
+      }
+      exchange.headers.emplace(std::move(name), std::move(value));
+    }
+
+    if (!reader.readVarint(chunkCount)) {
+      return false;
+    }
+    for (std::uint64_t c = 0; c < chunkCount; ++c) {
+      std::uint64_t offset;
+      Chunk chunk;
+      if (!reader.readVarint(offset) || !reader.readString(chunk.data)) {
+        return false;
+      }
+      chunk.offset = std::chrono::microseconds(offset);
+      exchange.chunks.push_back(std::move(chunk));
+    }
+
+    std::string key = keyOf(exchange.method, exchange.url, exchange.body);
+    auto &slot = loaded[key];
+    if (!slot) {
+      slot = std::make_unique<Recordings>();
+      order.push_back(key);
+    }
+    slot->exchanges.push_back(std::move(exchange));
+  }
+
+  recordings = std::move(loaded);
+  keyOrder = std::move(order);
+  return true;
+}
+
+} // namespace zuno
@@ -0,0 +1,244 @@
+#include "RequestSetup.hpp"
+#include "EventLoop.hpp"
+#include "SharedCache.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <memory>
+
+namespace zuno {
+
+// libcurl global state, set up by the first client and kept until the
+// process exits. curl_global_init is not thread-safe and cleaning up while
+// another client is alive breaks it, so neither may happen per client.
+void ensureCurlGlobalInit() {
+  struct CurlGlobal {
+    CurlGlobal() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+    ~CurlGlobal() {
+      EventLoop::waitForDetached();
+      curl_global_cleanup();
+    }
+  };
+  static CurlGlobal global;
+}
+
+std::string requestBody(const std::string &method, const nlohmann::json &data) {
+  if (method != "GET" && method != "HEAD" && method != "DELETE") {
+    return data.dump();
+  }
+  return {};
+}
+
+struct curl_slist *
+setupHandle(CURL *curl, const std::string &url, const std::string &method,
+            const std::string &dataStr,
+            const std::unordered_map<std::string, std::string> &headers,
+            const UnixSocket &socket, SharedCache *cache) {
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+
+  if (cache) {
+    cache->attach(curl);
+  }
+
+  if (!socket.path.empty()) {
+    curl_easy_setopt(curl,
+                     socket.abstractNamespace ? CURLOPT_ABSTRACT_UNIX_SOCKET
+                                              : CURLOPT_UNIX_SOCKET_PATH,
+                     socket.path.c_str());
+  }
+
+  if (method != "GET" && method != "HEAD" && method != "DELETE") {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, dataStr.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, dataStr.size());
+  }
+
+  if (method != "GET") {
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+  }
+  if (method == "HEAD") {
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  }
+
+  struct curl_slist *chunk = nullptr;
+  for (const auto &header : headers) {
+    std::string headerStr = header.first + ": " + header.second;
+    chunk = curl_slist_append(chunk, headerStr.c_str());
+  }
+
+  if (method != "GET" && method != "HEAD") {
+    std::string contentLengthHeader =
+        "Content-Length: " + std::to_string(dataStr.size());
+    chunk = curl_slist_append(chunk, contentLengthHeader.c_str());
+  }
+
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
+  return chunk;
+}
+
+bool finishRequest(CURL *curl, struct curl_slist *chunk, CURLcode res,
+                   std::string &readBuffer, HttpResponse &response) {
+  long httpCode = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+
+  curl_slist_free_all(chunk);
+
+  if (res != CURLE_OK) {
+    std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
+              << std::endl;
+    response.success = false;
+    return false;
+  }
+
+  response.statusCode = static_cast<int>(httpCode);
+  response.body = std::move(readBuffer);
+  response.success = (httpCode >= 200 && httpCode < 300);
+  return true;
+}
+
+std::string originOf(const std::string &url) {
+  CURLU *handle = curl_url();
+  if (!handle) {
+    return {};
+  }
+
+  std::string origin;
+  char *scheme = nullptr;
+  char *host = nullptr;
+  char *port = nullptr;
+  if (curl_url_set(handle, CURLUPART_URL, url.c_str(),
+                   CURLU_NON_SUPPORT_SCHEME) == CURLUE_OK &&
+      curl_url_get(handle, CURLUPART_SCHEME, &scheme, 0) == CURLUE_OK &&
+      curl_url_get(handle, CURLUPART_HOST, &host, 0) == CURLUE_OK &&
+      curl_url_get(handle, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) ==
+          CURLUE_OK) {
+    origin = std::string(scheme) + "://" + host + ":" + port;
+    std::transform(origin.begin(), origin.end(), origin.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+  }
+
+  curl_free(scheme);
+  curl_free(host);
+  curl_free(port);
+  curl_url_cleanup(handle);
+  return origin;
+}
+
+void interceptResponse(ResponseInterceptor *interceptor, std::string &url,
+                       std::string &method, nlohmann::json &data,
+                       std::unordered_map<std::string, std::string> &headers,
+                       BaseResponse &response) {
+  if (!interceptor) {
+    return;
+  }
+  HttpResponse tempResponse;
+  tempResponse.statusCode = response.statusCode;
+  tempResponse.headers = response.headers;
+  tempResponse.success = response.success;
+
+  interceptor->interceptResponse(url, method, data, headers, tempResponse);
+
+  // Copy back any modified headers
+  response.headers = tempResponse.headers;
+}
+
+TransportRequest
+transportRequest(const std::string &url, const std::string &method,
+                 const nlohmann::json &data,
+                 const std::unordered_map<std::string, std::string> &headers,
+                 const UnixSocket &socket) {
+  return {url, method, requestBody(method, data), headers, socket};
+}
+
+bool applyTransportResponse(BaseResponse result, BaseResponse &response) {
+  response.statusCode = result.statusCode;
+  response.headers = std::move(result.headers);
+  response.success = result.success;
+  return result.statusCode != 0;
+}
+
+bool performOverTransport(
+    Transport &transport, const std::string &url, const std::string &method,
+    const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers,
+    const UnixSocket &socket, const ChunkSink &onChunk,
+    BaseResponse &response) {
+  return applyTransportResponse(
+      transport.perform(transportRequest(url, method, data, headers, socket),
+                        onChunk),
+      response);
+}
+
+namespace {
+
+struct Delivery {
+  TransportScheduler &scheduler;
+  std::vector<TimedChunk> chunks;
+  size_t next = 0;
+  std::chrono::steady_clock::time_point doneAt;
+  ChunkSink onChunk;
+  std::function<void()> onDone;
+};
+
+// Delivers what is due and sets a timer for the rest.
+void step(const std::shared_ptr<Delivery> &delivery) {
+  auto now = std::chrono::steady_clock::now();
+  while (delivery->next < delivery->chunks.size()) {
+    TimedChunk &chunk = delivery->chunks[delivery->next];
+    if (chunk.due > now) {
+      delivery->scheduler.postAt(chunk.due, [delivery]() { step(delivery); });
+      return;
+    }
+    delivery->onChunk(chunk.data);
+    std::string().swap(chunk.data);
+    ++delivery->next;
+  }
+  if (delivery->doneAt > now) {
+    delivery->scheduler.postAt(delivery->doneAt,
+                               [delivery]() { step(delivery); });
+    return;
+  }
+  delivery->onDone();
+}
+
+} // namespace
+
+void deliverChunks(TransportScheduler &scheduler,
+                   std::vector<TimedChunk> chunks,
+                   std::chrono::steady_clock::time_point doneAt,
+                   ChunkSink onChunk, std::function<void()> onDone) {
+  step(std::make_shared<Delivery>(Delivery{scheduler, std::move(chunks), 0,
+                                           doneAt, std::move(onChunk),
+                                           std::move(onDone)}));
+}
+
+size_t HeaderCallback(char *buffer, size_t size, size_t nitems, void *userp) {
+  size_t realSize = size * nitems;
+  auto *headers =
+      static_cast<std::unordered_map<std::string, std::string> *>(userp);
+
+  std::string line(buffer, realSize);
+  size_t colon = line.find(':');
+  if (colon == std::string::npos) {
+    // Status line or the blank line ending a header block. A new status line
+    // means a redirect or 100-continue, so drop what came before it.
+    if (line.rfind("HTTP/", 0) == 0) {
+      headers->clear();
+    }
+    return realSize;
+  }
+
+  std::string name = line.substr(0, colon);
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+  size_t valueEnd = line.find_last_not_of(" \t\r\n");
+  std::string value;
+  if (valueStart != std::string::npos && valueEnd >= valueStart) {
+    value = line.substr(valueStart, valueEnd - valueStart + 1);
+  }
+  (*headers)[name] = value;
+  return realSize;
+}
+
+} // namespace zuno
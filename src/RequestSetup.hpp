@@ -0,0 +1,92 @@
+// src/RequestSetup.hpp
+
+#ifndef ZUNO_REQUESTSETUP_H
+#define ZUNO_REQUESTSETUP_H
+
+#include "zuno/RestClient.hpp"
+#include "zuno/Transport.hpp"
+#include <chrono>
+#include <curl/curl.h>
+#include <functional>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace zuno {
+
+class SharedCache;
+
+// Sets up libcurl global state on first call; it is kept until the process
+// exits.
+void ensureCurlGlobalInit();
+
+// Serialized request body; empty for methods that do not send one.
+std::string requestBody(const std::string &method, const nlohmann::json &data);
+
+// Applies URL, method, body, headers, socket routing and the client's shared
+// cache to an easy handle. dataStr must outlive the transfer; the returned
+// list is freed by the caller.
+struct curl_slist *
+setupHandle(CURL *curl, const std::string &url, const std::string &method,
+            const std::string &dataStr,
+            const std::unordered_map<std::string, std::string> &headers,
+            const UnixSocket &socket = {}, SharedCache *cache = nullptr);
+
+// "scheme://host:port" with the default port filled in, or an empty string
+// if the URL does not parse.
+std::string originOf(const std::string &url);
+
+// Frees the header list and fills in the response; the handle is left to
+// the caller. Returns false when the transfer itself failed.
+bool finishRequest(CURL *curl, struct curl_slist *chunk, CURLcode res,
+                   std::string &readBuffer, HttpResponse &response);
+
+// Runs the response interceptor for a response without a body (streams,
+// downloads) through a temporary HttpResponse and copies back the headers.
+void interceptResponse(ResponseInterceptor *interceptor, std::string &url,
+                       std::string &method, nlohmann::json &data,
+                       std::unordered_map<std::string, std::string> &headers,
+                       BaseResponse &response);
+
+// The request as handed to a transport.
+TransportRequest
+transportRequest(const std::string &url, const std::string &method,
+                 const nlohmann::json &data,
+                 const std::unordered_map<std::string, std::string> &headers,
+                 const UnixSocket &socket);
+
+// Copies status, headers and success from a transport's result. Returns
+// false when the transport itself failed.
+bool applyTransportResponse(BaseResponse result, BaseResponse &response);
+
+// Sends a request through a custom transport, filling in status, headers and
+// success. Returns false when the transport itself failed.
+bool performOverTransport(
+    Transport &transport, const std::string &url, const std::string &method,
+    const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers,
+    const UnixSocket &socket, const ChunkSink &onChunk,
+    BaseResponse &response);
+
+// Body piece of a simulated response and when it is due.
+struct TimedChunk {
+  std::chrono::steady_clock::time_point due;
+  std::string data;
+};
+
+// Hands chunks to onChunk in order, none before it is due, then calls onDone
+// no earlier than doneAt. Waits are timers on scheduler; whatever is already
+// due is delivered before this returns.
+void deliverChunks(TransportScheduler &scheduler,
+                   std::vector<TimedChunk> chunks,
+                   std::chrono::steady_clock::time_point doneAt,
+                   ChunkSink onChunk, std::function<void()> onDone);
+
+// CURLOPT_HEADERFUNCTION collecting response headers into the
+// std::unordered_map passed as userdata. Names are stored lower-cased.
+size_t HeaderCallback(char *buffer, size_t size, size_t nitems, void *userp);
+
+} // namespace zuno
+
+#endif // ZUNO_REQUESTSETUP_H
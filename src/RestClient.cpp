@@ -1,17 +1,136 @@
 #include "zuno/RestClient.hpp"
 #include "zuno/RequestInterceptor.hpp"
 #include "zuno/ResponseInterceptor.hpp"
+#include "zuno/Transport.hpp"
+#include "EventLoop.hpp"
+#include "HandlePool.hpp"
+#include "RequestSetup.hpp"
+#include "SharedCache.hpp"
+#include <atomic>
 #include <curl/curl.h>
+#include <deque>
 #include <functional>
 #include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace zuno {
 
-RestClient::RestClient() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+namespace {
+
+// Bytes a ChunkStream buffers before its transfer is paused.
+constexpr size_t kStreamBufferLimit = 1 << 20;
+
+// Runs a request on a transport's asynchronous path; the coroutine resumes on
+// the loop once the transport is done. keepAlive holds the loop until then.
+struct TransportAwaiter {
+  std::shared_ptr<Transport> transport;
+  EventLoop &loop;
+  std::shared_ptr<void> keepAlive;
+  TransportRequest request;
+  ChunkSink onChunk;
+  BaseResponse result{};
+  // Set by whichever of onDone and await_suspend finishes first. The frame
+  // must not be resumed while performAsync is still running, and onDone may
+  // run before it returns.
+  std::atomic<bool> handedOff{false};
+
+  bool await_ready() const noexcept { return false; }
+
+  bool await_suspend(std::coroutine_handle<> handle) {
+    transport->performAsync(
+        std::move(request), std::move(onChunk),
+        [this, handle, keepAlive = keepAlive](BaseResponse response) {
+          result = std::move(response);
+          if (handedOff.exchange(true)) {
+            loop.post([handle]() { handle.resume(); });
+          }
+        },
+        loop);
+    // Completed already: carry on without a trip through the loop.
+    return !handedOff.exchange(true);
+  }
+
+  BaseResponse await_resume() { return std::move(result); }
+};
+
+// Suspends until fn has run on a thread of its own, then resumes on the
+// loop. For blocking work that must not stall the loop thread.
+struct OffLoopAwaiter {
+  EventLoop &loop;
+  std::function<void()> fn;
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    std::thread([this, handle]() {
+      fn();
+      loop.post([handle]() { handle.resume(); });
+    }).detach();
+  }
+
+  void await_resume() const noexcept {}
+};
+
+// Leaves one pooled handle per origin with an open connection. Each origin
+// is a blocking HEAD on a thread of its own, so they run in parallel.
+void warmPool(HandlePool &pool, SharedCache *cache,
+              const std::vector<std::pair<std::string, UnixSocket>> &targets) {
+  std::vector<std::thread> threads;
+  threads.reserve(targets.size());
+  for (const auto &target : targets) {
+    threads.emplace_back([&pool, cache, &target]() {
+      std::string origin = originOf(target.first);
+      CURL *curl = pool.acquire(origin);
+      if (!curl) {
+        return;
+      }
+      struct curl_slist *headerList = setupHandle(
+          curl, target.first, "HEAD", "", {}, target.second, cache);
+      curl_easy_perform(curl);
+      curl_slist_free_all(headerList);
+      pool.release(curl, origin);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+struct RestClient::LoopHolder {
+  std::once_flag once;
+  std::unique_ptr<EventLoop> loop;
+  // Transfers still on the loop reference the cache, so it goes after the
+  // loop.
+  std::shared_ptr<SharedCache> cache;
+
+  // The last copy of a client may be destroyed by a coroutine running on the
+  // loop thread, which release() handles.
+  ~LoopHolder() { EventLoop::release(std::move(loop), std::move(cache)); }
+};
+
+RestClient::RestClient() {
+  ensureCurlGlobalInit();
+  sharedCache = std::make_shared<SharedCache>();
+  handlePool = std::make_shared<HandlePool>(sharedCache);
+  loopHolder = std::make_shared<LoopHolder>();
+  loopHolder->cache = sharedCache;
+}
+
+RestClient::~RestClient() = default;
 
-RestClient::~RestClient() { curl_global_cleanup(); }
+EventLoop &RestClient::eventLoop() {
+  LoopHolder &holder = *loopHolder;
+  std::call_once(holder.once,
+                 [&holder]() { holder.loop = std::make_unique<EventLoop>(); });
+  return *holder.loop;
+}
 
 void RestClient::setRequestInterceptor(
     std::shared_ptr<RequestInterceptor> requestInterceptor) {
@@ -23,6 +142,41 @@ void RestClient::setResponseInterceptor(
   this->responseInterceptor = responseInterceptor;
 }
 
+void RestClient::setTransport(std::shared_ptr<Transport> transport) {
+  this->transport = transport;
+}
+
+void RestClient::setUnixSocket(const std::string &path,
+                               bool abstractNamespace) {
+  unixSocket = {path, abstractNamespace};
+}
+
+void RestClient::setOriginUnixSocket(const std::string &origin,
+                                     const std::string &path,
+                                     bool abstractNamespace) {
+  std::string key = originOf(origin);
+  if (key.empty()) {
+    std::cerr << "Invalid origin for Unix socket route: " << origin
+              << std::endl;
+    return;
+  }
+  if (path.empty()) {
+    originUnixSockets.erase(key);
+  } else {
+    originUnixSockets[key] = {path, abstractNamespace};
+  }
+}
+
+UnixSocket RestClient::unixSocketFor(const std::string &url) const {
+  if (!originUnixSockets.empty()) {
+    auto it = originUnixSockets.find(originOf(url));
+    if (it != originUnixSockets.end()) {
+      return it->second;
+    }
+  }
+  return unixSocket;
+}
+
 HttpResponse RestClient::performRequest(
     const std::string &url, const std::string &method,
     const nlohmann::json &data,
@@ -38,65 +192,46 @@ HttpResponse RestClient::performRequest(
                                          mutableHeaders);
   }
 
-  CURL *curl = curl_easy_init();
-  CURLcode res;
-  std::string readBuffer;
   HttpResponse response;
 
-  if (curl) {
-    curl_easy_setopt(curl, CURLOPT_URL, mutableUrl.c_str());
-
-    std::string dataStr;
-    if (mutableMethod != "GET" && mutableMethod != "HEAD" &&
-        mutableMethod != "DELETE") {
-      dataStr = mutableData.dump();
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, dataStr.c_str());
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, dataStr.size());
+  if (transport) {
+    if (performOverTransport(
+            *transport, mutableUrl, mutableMethod, mutableData, mutableHeaders,
+            unixSocketFor(mutableUrl),
+            [&response](const std::string &data) { response.body.append(data); },
+            response) &&
+        responseInterceptor) {
+      responseInterceptor->interceptResponse(
+          mutableUrl, mutableMethod, mutableData, mutableHeaders, response);
     }
+    return response;
+  }
 
-    if (mutableMethod != "GET") {
-      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, mutableMethod.c_str());
-    }
-    if (mutableMethod == "HEAD") {
-      curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-    }
+  // Borrowed from the pool, so the connection of an earlier request (or of
+  // prewarm) is reused.
+  std::string origin = originOf(mutableUrl);
+  CURL *curl = handlePool->acquire(origin);
+
+  if (curl) {
+    std::string readBuffer;
+    std::string dataStr = requestBody(mutableMethod, mutableData);
+    struct curl_slist *chunk =
+        setupHandle(curl, mutableUrl, mutableMethod, dataStr, mutableHeaders,
+                    unixSocketFor(mutableUrl), sharedCache.get());
 
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response.headers);
 
-    struct curl_slist *chunk = nullptr;
-    for (const auto &header : mutableHeaders) {
-      std::string headerStr = header.first + ": " + header.second;
-      chunk = curl_slist_append(chunk, headerStr.c_str());
-    }
+    CURLcode res = curl_easy_perform(curl);
 
-    if (mutableMethod != "GET" && mutableMethod != "HEAD") {
-      std::string contentLengthHeader =
-          "Content-Length: " + std::to_string(dataStr.size());
-      chunk = curl_slist_append(chunk, contentLengthHeader.c_str());
-    }
-
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
-
-    res = curl_easy_perform(curl);
-
-    long httpCode = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(chunk);
-
-    if (res != CURLE_OK) {
-      std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
-                << std::endl;
-      response.success = false;
+    bool reached = finishRequest(curl, chunk, res, readBuffer, response);
+    handlePool->release(curl, origin);
+    if (!reached) {
       return response;
     }
 
-    response.statusCode = static_cast<int>(httpCode);
-    response.body = readBuffer;
-    response.success = (httpCode >= 200 && httpCode < 300);
-
     if (responseInterceptor) {
       responseInterceptor->interceptResponse(
           mutableUrl, mutableMethod, mutableData, mutableHeaders, response);
@@ -160,47 +295,42 @@ BaseResponse RestClient::performStreamRequest(
                                        mutableHeaders);
   }
 
-  CURL *curl = curl_easy_init();
-  CURLcode res;
   BaseResponse response;
+
+  if (transport) {
+    bool reached = performOverTransport(
+        *transport, mutableUrl, mutableMethod, mutableData, mutableHeaders,
+        unixSocketFor(mutableUrl),
+        [&callback](const std::string &data) { callback({data, false}); },
+        response);
+    callback({"", true});
+    if (reached) {
+      interceptResponse(responseInterceptor.get(), mutableUrl, mutableMethod,
+                        mutableData, mutableHeaders, response);
+    }
+    return response;
+  }
+
+  std::string origin = originOf(mutableUrl);
+  CURL *curl = handlePool->acquire(origin);
+  CURLcode res;
   StreamCallbackData callbackData = {callback, true};
 
   if (curl) {
-    curl_easy_setopt(curl, CURLOPT_URL, mutableUrl.c_str());
-
-    std::string dataStr;
-    if (mutableMethod != "GET" && mutableMethod != "HEAD" &&
-        mutableMethod != "DELETE") {
-      dataStr = mutableData.dump();
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, dataStr.c_str());
-      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, dataStr.size());
-    }
+    std::string dataStr = requestBody(mutableMethod, mutableData);
+    struct curl_slist *chunk =
+        setupHandle(curl, mutableUrl, mutableMethod, dataStr, mutableHeaders,
+                    unixSocketFor(mutableUrl), sharedCache.get());
 
-    if (mutableMethod != "GET") {
-      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, mutableMethod.c_str());
-    }
-    
     // Set up streaming callback
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamWriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &callbackData);
-    
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response.headers);
+
     // Enable streaming mode
     curl_easy_setopt(curl, CURLOPT_HTTP_TRANSFER_DECODING, 1L);
 
-    struct curl_slist *chunk = nullptr;
-    for (const auto &header : mutableHeaders) {
-      std::string headerStr = header.first + ": " + header.second;
-      chunk = curl_slist_append(chunk, headerStr.c_str());
-    }
-
-    if (mutableMethod != "GET" && mutableMethod != "HEAD") {
-      std::string contentLengthHeader =
-          "Content-Length: " + std::to_string(dataStr.size());
-      chunk = curl_slist_append(chunk, contentLengthHeader.c_str());
-    }
-
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
-
     res = curl_easy_perform(curl);
 
     long httpCode = 0;
@@ -212,7 +342,7 @@ BaseResponse RestClient::performStreamRequest(
     finalChunk.isLast = true;
     callback(finalChunk);
 
-    curl_easy_cleanup(curl);
+    handlePool->release(curl, origin);
     curl_slist_free_all(chunk);
 
     if (res != CURLE_OK) {
@@ -227,18 +357,8 @@ BaseResponse RestClient::performStreamRequest(
 
     // We don't have a response body to intercept for streaming requests
     // but we can still call the interceptor with an empty HttpResponse if needed
-    if (responseInterceptor) {
-      HttpResponse tempResponse;
-      tempResponse.statusCode = response.statusCode;
-      tempResponse.headers = response.headers;
-      tempResponse.success = response.success;
-      
-      responseInterceptor->interceptResponse(
-          mutableUrl, mutableMethod, mutableData, mutableHeaders, tempResponse);
-          
-      // Copy back any modified headers
-      response.headers = tempResponse.headers;
-    }
+    interceptResponse(responseInterceptor.get(), mutableUrl, mutableMethod,
+                      mutableData, mutableHeaders, response);
   }
 
   return response;
@@ -346,6 +466,433 @@ std::future<BaseResponse> RestClient::delStreamAsync(
   return std::async(std::launch::async, &RestClient::delStream, this, url, callback, headers);
 }
 
+// Coroutines - Standard responses
+Task<HttpResponse> RestClient::coPerformRequest(
+    std::string url, std::string method, nlohmann::json data,
+    std::unordered_map<std::string, std::string> headers) {
+
+  if (requestInterceptor) {
+    requestInterceptor->interceptRequest(url, method, data, headers);
+  }
+
+  HttpResponse response;
+
+  if (transport) {
+    // Named rather than a temporary: GCC may copy a braced temporary in a
+    // co_await operand bitwise, which breaks the strings inside it.
+    TransportAwaiter call{
+        transport, eventLoop(), loopHolder,
+        transportRequest(url, method, data, headers, unixSocketFor(url)),
+        [&response](const std::string &chunk) { response.body.append(chunk); }};
+    BaseResponse result = co_await call;
+    if (applyTransportResponse(std::move(result), response) &&
+        responseInterceptor) {
+      responseInterceptor->interceptResponse(url, method, data, headers,
+                                             response);
+    }
+    co_return response;
+  }
+
+  CURL *curl = curl_easy_init();
+
+  if (!curl) {
+    co_return response;
+  }
+
+  std::string readBuffer;
+  std::string dataStr = requestBody(method, data);
+  struct curl_slist *chunk =
+      setupHandle(curl, url, method, dataStr, headers, unixSocketFor(url),
+                  sharedCache.get());
+
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response.headers);
+
+  CURLcode res = co_await eventLoop().transfer(curl);
+
+  bool reached = finishRequest(curl, chunk, res, readBuffer, response);
+  curl_easy_cleanup(curl);
+  if (reached && responseInterceptor) {
+    responseInterceptor->interceptResponse(url, method, data, headers,
+                                           response);
+  }
+
+  co_return response;
+}
+
+Task<HttpResponse>
+RestClient::co_get(const std::string &url,
+                   const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformRequest(url, "GET", {}, headers);
+}
+
+Task<HttpResponse> RestClient::co_post(
+    const std::string &url, const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformRequest(url, "POST", data, headers);
+}
+
+Task<HttpResponse>
+RestClient::co_put(const std::string &url, const nlohmann::json &data,
+                   const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformRequest(url, "PUT", data, headers);
+}
+
+Task<HttpResponse> RestClient::co_patch(
+    const std::string &url, const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformRequest(url, "PATCH", data, headers);
+}
+
+Task<HttpResponse>
+RestClient::co_del(const std::string &url,
+                   const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformRequest(url, "DELETE", {}, headers);
+}
+
+Task<HttpResponse> RestClient::co_head(
+    const std::string &url,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformRequest(url, "HEAD", {}, headers);
+}
+
+// Prewarming
+Task<size_t> RestClient::coPerformPrewarm(std::vector<std::string> origins) {
+  // The blocking methods borrow pooled handles that keep connections of
+  // their own, so those are warmed too, alongside the loop's. Failures are
+  // reported by the loop's attempt.
+  std::vector<std::pair<std::string, UnixSocket>> poolTargets;
+  for (const auto &origin : origins) {
+    poolTargets.emplace_back(origin, unixSocketFor(origin));
+  }
+  std::future<void> pooled = std::async(
+      std::launch::async, [pool = handlePool, cache = sharedCache,
+                           poolTargets = std::move(poolTargets)]() {
+        warmPool(*pool, cache.get(), poolTargets);
+      });
+
+  std::vector<CURL *> handles;
+  std::vector<struct curl_slist *> headerLists;
+  std::vector<std::string> targets;
+  for (const auto &origin : origins) {
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+      continue;
+    }
+    targets.push_back(origin);
+    // A HEAD request rather than CURLOPT_CONNECT_ONLY: connect-only
+    // connections are never handed to later transfers.
+    headerLists.push_back(setupHandle(curl, origin, "HEAD", "", {},
+                                      unixSocketFor(origin),
+                                      sharedCache.get()));
+    handles.push_back(curl);
+  }
+
+  std::vector<CURLcode> results = co_await eventLoop().transferAll(handles);
+
+  size_t reached = 0;
+  for (size_t i = 0; i < handles.size(); ++i) {
+    if (results[i] == CURLE_OK) {
+      ++reached;
+    } else {
+      std::cerr << "Prewarming " << targets[i]
+                << " failed: " << curl_easy_strerror(results[i]) << std::endl;
+    }
+    curl_easy_cleanup(handles[i]);
+    curl_slist_free_all(headerLists[i]);
+  }
+
+  if (pooled.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    co_await OffLoopAwaiter{eventLoop(), [&pooled]() { pooled.wait(); }};
+  }
+
+  co_return reached;
+}
+
+size_t RestClient::prewarm(const std::vector<std::string> &origins) {
+  return syncWait(coPerformPrewarm(origins));
+}
+
+Task<size_t> RestClient::co_prewarm(const std::vector<std::string> &origins) {
+  return coPerformPrewarm(origins);
+}
+
+// Coroutines - Streaming responses
+struct ChunkStream::State : std::enable_shared_from_this<ChunkStream::State> {
+  std::mutex mutex;
+  std::deque<StreamChunk> chunks;
+  size_t bufferedBytes = 0;
+  bool finished = false;
+  bool paused = false;
+  std::coroutine_handle<> waiter;
+  BaseResponse response{};
+  // Filled on the loop thread while the transfer runs
+  std::unordered_map<std::string, std::string> responseHeaders;
+
+  EventLoop *loop = nullptr;
+  CURL *curl = nullptr;
+  std::uint64_t transferId = 0;
+
+  // Request data that has to outlive the transfer.
+  std::string url;
+  std::string method;
+  nlohmann::json data;
+  std::unordered_map<std::string, std::string> headers;
+  std::string dataStr;
+  struct curl_slist *headerList = nullptr;
+  std::shared_ptr<ResponseInterceptor> responseInterceptor;
+
+  static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
+                              void *userp);
+  void finish(CURLcode res);
+  // Used on the transport path, from whichever thread the transport calls
+  // back on. Transports cannot be paused, so the buffer is not bounded.
+  void push(const std::string &chunk);
+  // Stores the final response and returns the waiter to resume.
+  std::coroutine_handle<> complete(BaseResponse result);
+};
+
+// Runs on the loop thread. Waiters are resumed through post() so consumer
+// code never runs inside a curl callback.
+size_t ChunkStream::State::WriteCallback(void *contents, size_t size,
+                                         size_t nmemb, void *userp) {
+  size_t realSize = size * nmemb;
+  auto *state = static_cast<State *>(userp);
+
+  std::coroutine_handle<> waiter;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->waiter && state->bufferedBytes >= kStreamBufferLimit) {
+      state->paused = true;
+      return CURL_WRITEFUNC_PAUSE;
+    }
+    if (realSize > 0) {
+      state->chunks.push_back(
+          {std::string(static_cast<char *>(contents), realSize), false});
+      state->bufferedBytes += realSize;
+      waiter = std::exchange(state->waiter, {});
+    }
+  }
+
+  if (waiter) {
+    state->loop->post([waiter]() { waiter.resume(); });
+  }
+  return realSize;
+}
+
+void ChunkStream::State::finish(CURLcode res) {
+  long httpCode = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+
+  curl_easy_cleanup(curl);
+  curl_slist_free_all(headerList);
+  curl = nullptr;
+  headerList = nullptr;
+
+  BaseResponse result{};
+  if (res != CURLE_OK) {
+    std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res)
+              << std::endl;
+    result.success = false;
+  } else {
+    result.statusCode = static_cast<int>(httpCode);
+    result.headers = std::move(responseHeaders);
+    result.success = (httpCode >= 200 && httpCode < 300);
+    interceptResponse(responseInterceptor.get(), url, method, data, headers,
+                      result);
+  }
+
+  if (std::coroutine_handle<> resumeWaiter = complete(std::move(result))) {
+    resumeWaiter.resume();
+  }
+}
+
+void ChunkStream::State::push(const std::string &chunk) {
+  std::coroutine_handle<> resumeWaiter;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    chunks.push_back({chunk, false});
+    bufferedBytes += chunk.size();
+    resumeWaiter = std::exchange(waiter, {});
+  }
+
+  if (resumeWaiter) {
+    loop->post([resumeWaiter]() { resumeWaiter.resume(); });
+  }
+}
+
+std::coroutine_handle<> ChunkStream::State::complete(BaseResponse result) {
+  std::lock_guard<std::mutex> lock(mutex);
+  response = std::move(result);
+  chunks.push_back({"", true});
+  finished = true;
+  // The transfer is gone; draining the buffer must not try to unpause it.
+  paused = false;
+  return std::exchange(waiter, {});
+}
+
+ChunkStream::ChunkStream(std::shared_ptr<State> state)
+    : state(std::move(state)) {}
+
+ChunkStream::~ChunkStream() {
+  if (!state) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(state->mutex);
+  if (!state->finished && state->transferId != 0) {
+    state->loop->cancel(state->transferId);
+  }
+}
+
+ChunkStream::NextAwaiter ChunkStream::next() {
+  return NextAwaiter(state.get());
+}
+
+const BaseResponse &ChunkStream::response() const { return state->response; }
+
+bool ChunkStream::NextAwaiter::await_ready() {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  return !state->chunks.empty() || state->finished;
+}
+
+bool ChunkStream::NextAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  std::lock_guard<std::mutex> lock(state->mutex);
+  if (!state->chunks.empty() || state->finished) {
+    return false;
+  }
+  state->waiter = handle;
+  return true;
+}
+
+std::optional<StreamChunk> ChunkStream::NextAwaiter::await_resume() {
+  std::optional<StreamChunk> chunk;
+  bool resumeTransfer = false;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->chunks.empty()) {
+      return std::nullopt;
+    }
+    chunk = std::move(state->chunks.front());
+    state->chunks.pop_front();
+    state->bufferedBytes -= chunk->data.size();
+    if (state->paused && !state->finished &&
+        state->bufferedBytes < kStreamBufferLimit) {
+      state->paused = false;
+      resumeTransfer = true;
+    }
+  }
+
+  if (resumeTransfer) {
+    // curl_easy_pause() must be called from the thread driving the handle.
+    state->loop->post([self = state->shared_from_this()]() {
+      if (self->curl) {
+        curl_easy_pause(self->curl, CURLPAUSE_CONT);
+      }
+    });
+  }
+  return chunk;
+}
+
+ChunkStream RestClient::coPerformStreamRequest(
+    std::string url, std::string method, nlohmann::json data,
+    std::unordered_map<std::string, std::string> headers) {
+
+  if (requestInterceptor) {
+    requestInterceptor->interceptRequest(url, method, data, headers);
+  }
+
+  auto state = std::make_shared<ChunkStream::State>();
+  state->url = std::move(url);
+  state->method = std::move(method);
+  state->data = std::move(data);
+  state->headers = std::move(headers);
+  state->responseInterceptor = responseInterceptor;
+
+  if (transport) {
+    // Chunks reach the consumer as the transport delivers them. The
+    // completion handler holds the loop and the transport until it has run.
+    state->loop = &eventLoop();
+    std::shared_ptr<Transport> active = transport;
+    active->performAsync(
+        transportRequest(state->url, state->method, state->data,
+                         state->headers, unixSocketFor(state->url)),
+        [state](const std::string &chunk) { state->push(chunk); },
+        [state, active, keepAlive = loopHolder](BaseResponse result) {
+          BaseResponse response{};
+          if (applyTransportResponse(std::move(result), response)) {
+            interceptResponse(state->responseInterceptor.get(), state->url,
+                              state->method, state->data, state->headers,
+                              response);
+          }
+          std::coroutine_handle<> waiter = state->complete(std::move(response));
+          if (waiter) {
+            state->loop->post([waiter]() { waiter.resume(); });
+          }
+        },
+        *state->loop);
+    return ChunkStream(state);
+  }
+
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    state->response.success = false;
+    state->chunks.push_back({"", true});
+    state->finished = true;
+    return ChunkStream(state);
+  }
+
+  state->curl = curl;
+  state->loop = &eventLoop();
+  state->dataStr = requestBody(state->method, state->data);
+  state->headerList =
+      setupHandle(curl, state->url, state->method, state->dataStr,
+                  state->headers, unixSocketFor(state->url),
+                  sharedCache.get());
+
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ChunkStream::State::WriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, state.get());
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &state->responseHeaders);
+  curl_easy_setopt(curl, CURLOPT_HTTP_TRANSFER_DECODING, 1L);
+
+  state->transferId =
+      state->loop->add(curl, [state](CURLcode res) { state->finish(res); });
+
+  return ChunkStream(state);
+}
+
+ChunkStream RestClient::co_getStream(
+    const std::string &url,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformStreamRequest(url, "GET", {}, headers);
+}
+
+ChunkStream RestClient::co_postStream(
+    const std::string &url, const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformStreamRequest(url, "POST", data, headers);
+}
+
+ChunkStream RestClient::co_putStream(
+    const std::string &url, const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformStreamRequest(url, "PUT", data, headers);
+}
+
+ChunkStream RestClient::co_patchStream(
+    const std::string &url, const nlohmann::json &data,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformStreamRequest(url, "PATCH", data, headers);
+}
+
+ChunkStream RestClient::co_delStream(
+    const std::string &url,
+    const std::unordered_map<std::string, std::string> &headers) {
+  return coPerformStreamRequest(url, "DELETE", {}, headers);
+}
+
 // Callback de escritura
 size_t RestClient::WriteCallback(void *contents, size_t size, size_t nmemb,
                                  void *userp) {
@@ -0,0 +1,33 @@
+#include "SharedCache.hpp"
+
+namespace zuno {
+
+SharedCache::SharedCache() : share(curl_share_init()) {
+  if (!share) {
+    return;
+  }
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &SharedCache::lock);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &SharedCache::unlock);
+  curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+SharedCache::~SharedCache() { curl_share_cleanup(share); }
+
+void SharedCache::attach(CURL *curl) {
+  if (share) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+  }
+}
+
+void SharedCache::lock(CURL *, curl_lock_data data, curl_lock_access,
+                       void *userp) {
+  static_cast<SharedCache *>(userp)->locks[data].lock();
+}
+
+void SharedCache::unlock(CURL *, curl_lock_data data, void *userp) {
+  static_cast<SharedCache *>(userp)->locks[data].unlock();
+}
+
+} // namespace zuno
@@ -0,0 +1,35 @@
+// src/SharedCache.hpp
+
+#ifndef ZUNO_SHAREDCACHE_H
+#define ZUNO_SHAREDCACHE_H
+
+#include <curl/curl.h>
+#include <mutex>
+
+namespace zuno {
+
+// DNS cache and TLS sessions shared by every easy handle of one client, so
+// a handshake done on any thread (or by prewarm) speeds up the next request
+// to the same host.
+class SharedCache {
+public:
+  SharedCache();
+  ~SharedCache();
+
+  SharedCache(const SharedCache &) = delete;
+  SharedCache &operator=(const SharedCache &) = delete;
+
+  void attach(CURL *curl);
+
+private:
+  static void lock(CURL *handle, curl_lock_data data, curl_lock_access access,
+                   void *userp);
+  static void unlock(CURL *handle, curl_lock_data data, void *userp);
+
+  CURLSH *share;
+  std::mutex locks[CURL_LOCK_DATA_LAST];
+};
+
+} // namespace zuno
+
+#endif // ZUNO_SHAREDCACHE_H
@@ -0,0 +1,16 @@
+#include "zuno/Transport.hpp"
+#include <thread>
+
+namespace zuno {
+
+void Transport::performAsync(TransportRequest request, ChunkSink onChunk,
+                             CompletionHandler onDone, TransportScheduler &) {
+  // Nothing touches the transport after onDone, which may release it.
+  std::thread([this, request = std::move(request),
+               onChunk = std::move(onChunk),
+               onDone = std::move(onDone)]() {
+    onDone(perform(request, onChunk));
+  }).detach();
+}
+
+} // namespace zuno